@@ -181,13 +181,12 @@ int extractDB(const string &path, vector<Mat> &images, Mat &labels, int preproc,
     return nsubjects;
 }
 
-int crossfoldData(Ptr<Extractor> ext,
+int crossfoldData(const Mat &features,
                   Ptr<Filter> fil,
                   Mat & trainFeatures,
                   Mat & trainLabels,
                   Mat & testFeatures,
                   Mat & testLabels,
-                  const vector< Mat > &images,
                   const vector< int > &labels,
                   const vector< vector<int> > &persons,
                   size_t f, size_t fold)
@@ -206,11 +205,13 @@ int crossfoldData(Ptr<Extractor> ext,
             int index = persons[j][n];
 
             Mat feature;
-            ext->extract(images[index],feature);
-
             if (!fil.empty())
             {
-                fil->filter(feature, feature);
+                fil->filter(features.row(index), feature);
+            }
+            else
+            {
+                feature = features.row(index);
             }
 
             fsiz = feature.total() * feature.elemSize();
@@ -241,6 +242,11 @@ double runtest(string name, Ptr<Extractor> ext, Ptr<Filter> fil, Ptr<Classifier>
     Mat confusion = Mat::zeros(persons.size(),persons.size(),CV_32F);
 
     int64 t0=getTickCount();
+
+    // the features don't change per fold, so extract them only once
+    Mat features;
+    ext->extractBatch(images, features);
+
     int fsiz=0;
     for (size_t f=0; f<fold; f++)
     {
@@ -248,7 +254,7 @@ double runtest(string name, Ptr<Extractor> ext, Ptr<Filter> fil, Ptr<Classifier>
         Mat trainFeatures, trainLabels;
         Mat testFeatures,  testLabels;
 
-        fsiz = crossfoldData(ext,fil,trainFeatures,trainLabels,testFeatures,testLabels,images,labels,persons,f,fold);
+        fsiz = crossfoldData(features,fil,trainFeatures,trainLabels,testFeatures,testLabels,labels,persons,f,fold);
         trainFeatures = trainFeatures.reshape(1, trainLabels.rows);
 
         cls->train(trainFeatures, trainLabels);
@@ -316,6 +322,8 @@ void printOptions()
     for (size_t i=0; i<TextureFeature::FIL_MAX; ++i) {  if(i%5==0) cerr << endl; cerr << format("%10s(%2d)",TextureFeature::FILS[i],i); }
     cerr << endl << endl << "[classifiers] :" << endl;
     for (size_t i=0; i<TextureFeature::CL_MAX; ++i)  {  if(i%5==0) cerr << endl; cerr << format("%10s(%2d)",TextureFeature::CLS[i],i);  }
+    cerr << endl << endl << "[landmarks] :" << endl;
+    for (size_t i=0; i<TextureFeature::LAND_MAX; ++i) {  if(i%5==0) cerr << endl; cerr << format("%10s(%2d)",TextureFeature::LANDS[i],i);  }
     //cerr << endl << endl <<  "[preproc] :" << endl;
     //for (size_t i=0; i<TextureFeature::PRE_MAX; ++i) {  if(i%5==0) cerr << endl; cerr << format("%10s(%2d)",TextureFeature::PPS[i],i);  }
     cerr << endl;
@@ -335,6 +343,7 @@ int main(int argc, const char *argv[])
             "{ ext e          |14    | extractor  enum }"
             "{ fil f          |11    | filter   enum }"
             "{ cls c          |22    | classifier enum }"
+            "{ land l         |-1    | landmarks enum (-1: dlib if compiled in, else fixed) }"
             "{ all a          |false | run a hardcoded list of tests }"
             "{ pre P          |3     | preprocessing }"
             "{ crop C         |0     | crop outer pixels }"
@@ -357,6 +366,7 @@ int main(int argc, const char *argv[])
     int ext = parser.get<int>("ext");
     int fil = parser.get<int>("fil");
     int cls = parser.get<int>("cls");
+    int land = parser.get<int>("land");
     int pre = parser.get<int>("pre");
     int crp = parser.get<int>("crop");
     int fold = parser.get<int>("fold");
@@ -365,6 +375,8 @@ int main(int argc, const char *argv[])
     int maxim = parser.get<int>("maxim");
 
     std::string db_path = parser.get<String>("path");
+    if (land >= 0)
+        TextureFeature::setLandmarks(land);
 
     // load data:
     Mat labels;
@@ -425,11 +437,14 @@ int main(int argc, const char *argv[])
             TextureFeature::EXT_HDGRAD, TextureFeature::FIL_DCT12,  TextureFeature::CL_PCA_LDA,
             //TextureFeature::EXT_HDLBP,  TextureFeature::FIL_HELL,  TextureFeature::CL_SVM_INT2,
             TextureFeature::EXT_HDLBP,  TextureFeature::FIL_DCT6,  TextureFeature::CL_PCA_LDA,
+            TextureFeature::EXT_HDLBP_I, TextureFeature::FIL_DCT6,  TextureFeature::CL_PCA_LDA, // integer patches, compare to the line above
             TextureFeature::EXT_HDLBP_PCA,  TextureFeature::FIL_NONE,  TextureFeature::CL_PCA_LDA,
             TextureFeature::EXT_Sift,   TextureFeature::FIL_DCT12, TextureFeature::CL_PCA_LDA,
+            TextureFeature::EXT_DSift,  TextureFeature::FIL_DCT12, TextureFeature::CL_PCA_LDA, // dense sift, compare to the line above
             //TextureFeature::EXT_Sift,   TextureFeature::FIL_NONE,  TextureFeature::CL_PCA_LDA,
             //TextureFeature::EXT_Sift,   TextureFeature::FIL_NONE,  TextureFeature::CL_SVM_HEL,
             TextureFeature::EXT_Sift,   TextureFeature::FIL_HELL,  TextureFeature::CL_SVM_INT2,
+            TextureFeature::EXT_DSift,  TextureFeature::FIL_HELL,  TextureFeature::CL_SVM_INT2, // dense sift, compare to the line above
             //TextureFeature::EXT_Sift_G, TextureFeature::FIL_DCT8,  TextureFeature::CL_PCA_LDA,
             TextureFeature::EXT_Grad_P, TextureFeature::FIL_NONE,  TextureFeature::CL_PCA_LDA,
             //TextureFeature::EXT_Grad_P, TextureFeature::FIL_NONE,  TextureFeature::CL_SVM_HEL,
@@ -447,6 +462,15 @@ int main(int argc, const char *argv[])
         for (int i=0; tests[i]>-1; i+=3)
             runtest(tests[i], tests[i+1], tests[i+2], images, labels, persons, fold);
     }
+
+    // landmark backends, that were used:
+    for (int i=0; i<TextureFeature::LAND_MAX; i++)
+    {
+        int calls = 0;
+        double ms = TextureFeature::landmarkLatency(i, &calls);
+        if (calls > 0)
+            cout << format("landmarks %-12s %8d calls %8.3f ms", TextureFeature::LANDS[i], calls, ms) << endl;
+    }
     return 0;
 }
 
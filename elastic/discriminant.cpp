@@ -197,6 +197,31 @@ struct Part
     //}
 };
 
+//
+// the parts are independent, so they are searched in parallel,
+//   each one into its own slot (the outcome does not depend on the schedule).
+//
+struct PartsDetect : public ParallelLoopBody
+{
+    const vector<Part> &parts;
+    const Mat &I;
+    Point *pt;
+    double *q;
+
+    PartsDetect(const vector<Part> &parts, const Mat &I, Point *pt, double *q)
+        : parts(parts), I(I), pt(pt), q(q)
+    {}
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int k=range.start; k<range.end; k++)
+        {
+            q[k] = 0;
+            pt[k] = parts[k].detect(I, q[k]);
+        }
+    }
+};
+
 struct DiscriminantPartsImpl : public ElasticParts
 {
     vector<Part> parts;
@@ -207,16 +232,22 @@ struct DiscriminantPartsImpl : public ElasticParts
 
     virtual double getPoints(const Mat & img, vector<Point> &kp) const
     {
+        if (parts.empty())
+            return 0;
         Mat I = feature_img(img);
+        int n = int(parts.size());
+        vector<Point> pt(n);
+        vector<double> q(n);
+        parallel_for_(Range(0, n), PartsDetect(parts, I, &pt[0], &q[0]));
+
         double Q=0;
-        for (size_t k=0; k<parts.size(); k++)
+        for (int k=0; k<n; k++)
         {
-            double q=0;
-            Point p = parts[k].detect(I, q);
-            if (q < 0.6)
+            Point p = pt[k];
+            if (q[k] < 0.6)
                 p = parts[k].p;
             kp.push_back(p);
-            Q += q;
+            Q += q[k];
         }
         //cerr << endl << endl;
         return Q / parts.size();
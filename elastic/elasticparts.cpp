@@ -98,32 +98,45 @@ struct Part
         fn["f"] >> f;
     }
 
-    double distance(const Mat &a, const Mat &b) const
-    {
-        return norm(a,b);
-    }
-
+    //
+    // all 2*step x 2*step candidate positions are windows of one search area:
+    //   integer offsets from np keep its subpixel phase, so the area's bilinear
+    //   pixels are the same as those of each candidate's own getRectSubPix.
+    //   the squared distances are summed in one fixed order, so equal windows
+    //   tie exactly, and the first one (row major) wins, as before.
+    //
     double walk(const Mat &img, Point2f &np) const
     {
+        Mat_<float> area, F(f);
+        Size asize(F.cols + 2*step - 1, F.rows + 2*step - 1);
+        getRectSubPix(img, asize, Point2f(np.x - 0.5f, np.y - 0.5f), area);
+
         double mDist=DBL_MAX;
         Point2f best(np);
         for (int r=-step; r<step; r++)
         {
             for (int c=-step; c<step; c++)
             {
-                Point2f rs = Point2f(np.x+c, np.y+r);
-                Mat patch;
-                getRectSubPix(img, f.size(), rs, patch);
-                double d=distance(patch, f);
+                double d=0;
+                for (int y=0; y<F.rows; y++)
+                {
+                    const float *a = area[r+step+y] + c+step;
+                    const float *b = F[y];
+                    for (int x=0; x<F.cols; x++)
+                    {
+                        double v = a[x] - b[x];
+                        d += v*v;
+                    }
+                }
                 if (d<mDist) 
                 { 
                     mDist=d;
-                    best=rs; 
+                    best=Point2f(np.x+c, np.y+r); 
                 }
             }
         }
         np = best;
-        return mDist;
+        return sqrt(mDist);
     }
     void sample(const Mat &img)
     {
@@ -148,6 +161,29 @@ struct Part
 
 
 
+//
+// the parts walk independently, each one into its own slot.
+//
+struct PartsWalk : public ParallelLoopBody
+{
+    const vector<Part> &parts;
+    const Mat &fI;
+    vector<Point2f> &pt;
+
+    PartsWalk(const vector<Part> &parts, const Mat &fI, vector<Point2f> &pt)
+        : parts(parts), fI(fI), pt(pt)
+    {}
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int k=range.start; k<range.end; k++)
+        {
+            pt[k] = parts[k].p;
+            parts[k].walk(fI, pt[k]);
+        }
+    }
+};
+
 struct ElasticPartsImpl : public ElasticParts
 {
     vector<Part> parts;
@@ -232,10 +268,11 @@ struct ElasticPartsImpl : public ElasticParts
         Mat ims, fI;
         resize(img,ims,Size(),Part::scale,Part::scale);
         feature_img(ims,fI);
+        vector<Point2f> pt(parts.size());
+        parallel_for_(Range(0, int(parts.size())), PartsWalk(parts, fI, pt));
         for (size_t k=0; k<parts.size(); k++)
         {
-            Point2f p = parts[k].p;
-            parts[k].walk(fI, p);
+            Point2f p = pt[k];
             p /= Part::scale;
             kp.push_back(p);
         }
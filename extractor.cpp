@@ -17,9 +17,25 @@
  #include <dlib/opencv/cv_image.h>
 #endif
 
+//
+// the lbp-like code kernels have sse2 (and avx2, if the compiler was told so)
+// versions, else fall back to the plain per-pixel loops.
+//
+#ifdef HAVE_SSE
+ #ifdef __AVX2__
+  #include <immintrin.h>
+ #else
+  #include <emmintrin.h>
+ #endif
+#endif
+
 
 #include <vector>
 using std::vector;
+#include <map>
+#include <list>
+#include <typeinfo>
+#include <cstring>
 #include <iostream>
 using std::cerr;
 using std::endl;
@@ -58,6 +74,130 @@ struct ExtractorPixels : public TextureFeature::Extractor
 };
 
 
+//
+// sobel gradients of an image, orientation (fastAtan2(dx,dy), in degrees)
+// and magnitude, each computed on first use.
+//
+// consumers reach it through a Gradients handle. it is shared only inside an
+// ImageScope (below), which ExtractorFusion opens for each image, so fused
+// Grad, GradMag, GradBin and CDIKP members run the sobels once;
+// a single extractor on its own gets a private field.
+//
+struct GradientField
+{
+    Mat I;
+    mutable Mat gx, gy, ang, mag;
+
+    GradientField(const Mat &img=Mat()) : I(img) {}
+
+    bool made_for(const Mat &img) const
+    {
+        return img.data == I.data && img.size() == I.size() && img.type() == I.type() && img.step == I.step;
+    }
+    const Mat &dx() const
+    {
+        if (gx.empty()) Sobel(I, gx, CV_32F, 1, 0);
+        return gx;
+    }
+    const Mat &dy() const
+    {
+        if (gy.empty()) Sobel(I, gy, CV_32F, 0, 1);
+        return gy;
+    }
+    const Mat &angle() const
+    {
+        if (ang.empty())
+        {
+            ang.create(I.size(), CV_32F);
+            for (int r=0; r<I.rows; r++)
+                fastAtan2(dx().ptr<float>(r), dy().ptr<float>(r), ang.ptr<float>(r), I.cols, true);
+        }
+        return ang;
+    }
+    const Mat &magnitude() const
+    {
+        if (mag.empty())
+        {
+            mag.create(I.size(), CV_32F);
+            for (int r=0; r<I.rows; r++)
+                cv::magnitude(dx().ptr<float>(r), dy().ptr<float>(r), mag.ptr<float>(r), I.cols);
+        }
+        return mag;
+    }
+};
+
+//
+// the intermediates several extractors may ask for on the same image:
+// its gradients, its landmarks (per backend kind), and named code planes
+// (lbp codes of the whole image, the fplbp codes of the hdlbp scales).
+//
+// while an ImageScope is open on a thread, every consumer there,
+// that asks for the scoped image, gets the one shared set;
+// otherwise (or for any other image) it computes a private one.
+//
+struct ImageShared
+{
+    GradientField grad;
+    std::map<int, vector<Point> > landmarks;
+    std::map<String, Mat> planes;
+
+    ImageShared(const Mat &img) : grad(img) {}
+};
+
+struct ImageSlot
+{
+    ImageShared *top;
+    ImageSlot() : top(0) {}
+};
+static TLSData<ImageSlot> image_slot;
+
+struct ImageScope
+{
+    ImageShared shared;
+    ImageShared *prev;
+
+    ImageScope(const Mat &img) : shared(img)
+    {
+        ImageSlot *slot = image_slot.get();
+        prev = slot->top;
+        slot->top = &shared;
+    }
+    ~ImageScope()
+    {
+        image_slot.get()->top = prev;
+    }
+};
+
+// the scoped intermediates of img, or 0
+static ImageShared *shared_for(const Mat &img)
+{
+    ImageShared *s = image_slot.get()->top;
+    return (s && s->grad.made_for(img)) ? s : 0;
+}
+
+//
+// the shared field for img, if there is one, else a private one.
+//
+struct Gradients
+{
+    GradientField own;
+    const GradientField *field;
+
+    Gradients(const Mat &img) : field(0)
+    {
+        ImageShared *s = shared_for(img);
+        if (s)
+        {
+            field = &s->grad;
+            return;
+        }
+        own.I = img;
+        field = &own;
+    }
+    const GradientField *operator -> () const { return field; }
+};
+
+
 //
 // later use gridded histograms the same way as with lbp(h)
 //
@@ -68,11 +208,8 @@ struct FeatureGrad
 
     int operator() (const Mat &I, Mat &fI) const
     {
-        Mat s1, s2, s3(I.size(), CV_32F), s4, s5;
-        Sobel(I, s1, CV_32F, 1, 0);
-        Sobel(I, s2, CV_32F, 0, 1);
-        fastAtan2(s1.ptr<float>(0), s2.ptr<float>(0), s3.ptr<float>(0), I.total(), true);
-        fI = s3 / (360/nsec);
+        Gradients grad(I);
+        fI = grad->angle() / (360/nsec);
         fI.convertTo(fI,CV_8U);
 
         //magnitude(s1.ptr<float>(0), s2.ptr<float>(0), s3.ptr<float>(0), I.total());
@@ -86,125 +223,371 @@ struct FeatureGrad
 };
 
 
-struct FeatureLbp
+
+#ifdef HAVE_SSE
+//
+// vector traits for the lbp code kernels below.
+//   all compares are on unsigned bytes, producing 0xff/0x00 masks,
+//   so N codes are computed at once, and the result is bit-exact to the scalar loops.
+//
+struct V128
 {
-    int operator() (const Mat &I, Mat &fI) const
+    typedef __m128i T;
+    enum { N=16 };
+
+    static T load(const uchar *p)     { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(uchar *p, T v)  { _mm_storeu_si128((__m128i*)p, v); }
+    static T zero()                   { return _mm_setzero_si128(); }
+
+    // a > b (unsigned)
+    static T gt(T a, T b)
     {
-        Mat_<uchar> feature(I.size(),0);
-        Mat_<uchar> img(I);
-        const int m=1;
-        for (int r=m; r<img.rows-m; r++)
-        {
-            for (int c=m; c<img.cols-m; c++)
-            {
-                uchar v = 0;
-                uchar cen = img(r,c);
-                v |= (img(r-1,c  ) > cen) << 0;
-                v |= (img(r-1,c+1) > cen) << 1;
-                v |= (img(r  ,c+1) > cen) << 2;
-                v |= (img(r+1,c+1) > cen) << 3;
-                v |= (img(r+1,c  ) > cen) << 4;
-                v |= (img(r+1,c-1) > cen) << 5;
-                v |= (img(r  ,c-1) > cen) << 6;
-                v |= (img(r-1,c-1) > cen) << 7;
-                feature(r,c) = v;
-            }
-        }
-        fI = feature;
-        return 256;
+        const T s = _mm_set1_epi8(char(0x80));
+        return _mm_cmpgt_epi8(_mm_xor_si128(a,s), _mm_xor_si128(b,s));
+    }
+    // (a-b) > (c-d), needs 16bit
+    static T gt_diff(T a, T b, T c, T d)
+    {
+        const T z = zero();
+        T lo = _mm_cmpgt_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(a,z), _mm_unpacklo_epi8(b,z)),
+                               _mm_sub_epi16(_mm_unpacklo_epi8(c,z), _mm_unpacklo_epi8(d,z)));
+        T hi = _mm_cmpgt_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(a,z), _mm_unpackhi_epi8(b,z)),
+                               _mm_sub_epi16(_mm_unpackhi_epi8(c,z), _mm_unpackhi_epi8(d,z)));
+        return _mm_packs_epi16(lo,hi);
+    }
+    // v |= (mask & (1<<b))
+    static T put(T v, T mask, int b)
+    {
+        return _mm_or_si128(v, _mm_and_si128(mask, _mm_set1_epi8(char(1<<b))));
+    }
+
+    // 16bit halves, for weighted (interpolated) samples. weights sum up to 256,
+    //   so a weighted sum of bytes is at most 255*256, and fits unsigned.
+    struct W { T lo, hi; };
+    static W mul(T a, int w)
+    {
+        const T z = zero(), m = _mm_set1_epi16(short(w));
+        W r = { _mm_mullo_epi16(_mm_unpacklo_epi8(a,z), m), _mm_mullo_epi16(_mm_unpackhi_epi8(a,z), m) };
+        return r;
+    }
+    static W add(W a, W b)
+    {
+        W r = { _mm_add_epi16(a.lo,b.lo), _mm_add_epi16(a.hi,b.hi) };
+        return r;
+    }
+    // a > b (unsigned 16bit), packed back to byte masks
+    static T gt(W a, W b)
+    {
+        const T s = _mm_set1_epi16(short(0x8000));
+        T lo = _mm_cmpgt_epi16(_mm_xor_si128(a.lo,s), _mm_xor_si128(b.lo,s));
+        T hi = _mm_cmpgt_epi16(_mm_xor_si128(a.hi,s), _mm_xor_si128(b.hi,s));
+        return _mm_packs_epi16(lo,hi);
+    }
+};
+
+#ifdef __AVX2__
+struct V256
+{
+    typedef __m256i T;
+    enum { N=32 };
+
+    static T load(const uchar *p)     { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(uchar *p, T v)  { _mm256_storeu_si256((__m256i*)p, v); }
+    static T zero()                   { return _mm256_setzero_si256(); }
+
+    static T gt(T a, T b)
+    {
+        const T s = _mm256_set1_epi8(char(0x80));
+        return _mm256_cmpgt_epi8(_mm256_xor_si256(a,s), _mm256_xor_si256(b,s));
+    }
+    // unpack & pack both work per 128bit lane, so the order is preserved
+    static T gt_diff(T a, T b, T c, T d)
+    {
+        const T z = zero();
+        T lo = _mm256_cmpgt_epi16(_mm256_sub_epi16(_mm256_unpacklo_epi8(a,z), _mm256_unpacklo_epi8(b,z)),
+                                  _mm256_sub_epi16(_mm256_unpacklo_epi8(c,z), _mm256_unpacklo_epi8(d,z)));
+        T hi = _mm256_cmpgt_epi16(_mm256_sub_epi16(_mm256_unpackhi_epi8(a,z), _mm256_unpackhi_epi8(b,z)),
+                                  _mm256_sub_epi16(_mm256_unpackhi_epi8(c,z), _mm256_unpackhi_epi8(d,z)));
+        return _mm256_packs_epi16(lo,hi);
+    }
+    static T put(T v, T mask, int b)
+    {
+        return _mm256_or_si256(v, _mm256_and_si256(mask, _mm256_set1_epi8(char(1<<b))));
+    }
+
+    struct W { T lo, hi; };
+    static W mul(T a, int w)
+    {
+        const T z = zero(), m = _mm256_set1_epi16(short(w));
+        W r = { _mm256_mullo_epi16(_mm256_unpacklo_epi8(a,z), m), _mm256_mullo_epi16(_mm256_unpackhi_epi8(a,z), m) };
+        return r;
+    }
+    static W add(W a, W b)
+    {
+        W r = { _mm256_add_epi16(a.lo,b.lo), _mm256_add_epi16(a.hi,b.hi) };
+        return r;
+    }
+    static T gt(W a, W b)
+    {
+        const T s = _mm256_set1_epi16(short(0x8000));
+        T lo = _mm256_cmpgt_epi16(_mm256_xor_si256(a.lo,s), _mm256_xor_si256(b.lo,s));
+        T hi = _mm256_cmpgt_epi16(_mm256_xor_si256(a.hi,s), _mm256_xor_si256(b.hi,s));
+        return _mm256_packs_epi16(lo,hi);
     }
 };
+#endif // __AVX2__
+
+template <class V, class Feature>
+static int code_row_v(const Feature &fea, const Mat_<uchar> &img, int r, uchar *dst, int c)
+{
+    const int R = fea.border();
+    const uchar *p = img.ptr<uchar>(r);
+    const int st = (int)img.step;
+    for (; c+V::N <= img.cols-R; c+=V::N)
+    {
+        V::store(dst+c, fea.template codes<V>(p+c, st));
+    }
+    return c;
+}
+#endif // HAVE_SSE
 
 //
-// "Description of Interest Regions with Center-Symmetric Local Binary Patterns"
-// (http://www.ee.oulu.fi/mvg/files/pdf/pdf_750.pdf).
-//    (w/o threshold)
+// one row of codes, the vectorized part first, then the scalar code() for the rest.
+//   border pixels are 0, same as in the code image.
 //
-struct FeatureCsLbp
+template <class Feature>
+static void code_row(const Feature &fea, const Mat_<uchar> &img, int r, uchar *dst)
 {
-    int radius;
-    FeatureCsLbp(int r=1) : radius(r) {}
-    int operator() (const Mat &I, Mat &fI) const
+    const int R = fea.border();
+    if (r<R || r>=img.rows-R)
     {
-        Mat_<uchar> feature(I.size(),0);
-        Mat_<uchar> img(I);
-        const int R=radius;
-        for (int r=R; r<img.rows-R; r++)
-        {
-            for (int c=R; c<img.cols-R; c++)
-            {
-                uchar v = 0;
-                v |= (img(r-R,c  ) > img(r+R,c  )) << 0;
-                v |= (img(r-R,c+R) > img(r+R,c-R)) << 1;
-                v |= (img(r  ,c+R) > img(r  ,c-R)) << 2;
-                v |= (img(r+R,c+R) > img(r-R,c-R)) << 3;
-                feature(r,c) = v;
-            }
-        }
-        fI = feature;
-        return 16;
+        memset(dst, 0, img.cols);
+        return;
     }
-};
+    int c = R;
+#ifdef HAVE_SSE
+ #ifdef __AVX2__
+    c = code_row_v<V256>(fea, img, r, dst, c);
+ #endif
+    c = code_row_v<V128>(fea, img, r, dst, c);
+#endif
+    for (; c<img.cols-R; c++)
+    {
+        dst[c] = fea.code(img, r, c);
+    }
+    for (c=0; c<R && c<img.cols; c++)
+    {
+        dst[c] = dst[img.cols-1-c] = 0;
+    }
+}
 
+template <class Feature>
+static int code_image(const Feature &fea, const Mat &I, Mat &fI)
+{
+    Mat_<uchar> img(I);
+    Mat_<uchar> feature(I.size(),0);
+    for (int r=fea.border(); r<img.rows-fea.border(); r++)
+    {
+        code_row(fea, img, r, feature.ptr<uchar>(r));
+    }
+    fI = feature;
+    return fea.bins();
+}
 
 //
-// / \
-// \ /
+// the code image of img, computed once per ImageScope.
+// (features are told apart by type and border, which is their only parameter)
 //
-struct FeatureDiamondLbp
+template <class Feature>
+static int shared_code_image(const Feature &fea, const Mat &img, Mat &fI)
 {
-    int radius;
-    FeatureDiamondLbp(int r=1) : radius(r) {}
-    int operator() (const Mat &I, Mat &fI) const
+    ImageShared *s = shared_for(img);
+    if (!s)
+        return fea(img, fI);
+    Mat &plane = s->planes[format("%s/%d", typeid(Feature).name(), fea.border())];
+    if (plane.empty())
+        fea(img, plane);
+    fI = plane;
+    return fea.bins();
+}
+
+
+//
+// circular lbp, P neighbours on a ring of radius R,
+//   neighbour k sits at 2*pi*k/P, clockwise from 12 o'clock.
+//
+//   Interp: the points are bilinear sampled from the circle, with 8bit fixed point weights,
+//     else they are snapped to the square ring of radius R (like the classic 3x3 lbp).
+//   Cmp:
+//     LBP_CENTER  n[k] > center       P bits
+//     LBP_SYM     n[k] > n[k+P/2]     P/2 bits (center-symmetric)
+//     LBP_RING    n[k] > n[k+1]       P bits
+//
+//   the codes have to fit into a byte, so P<=8 (or 16 for LBP_SYM).
+//   trig is not constant in c++98, so the taps and weights get tabled once per instance.
+//
+enum { LBP_CENTER, LBP_SYM, LBP_RING };
+
+template <int P, int R, bool Interp=false, int Cmp=LBP_CENTER>
+struct FeatureLbpT
+{
+    enum { B = (Cmp==LBP_SYM) ? P/2 : P };
+    typedef char code_fits_a_byte[(B<=8 && P>=2) ? 1 : -1];
+
+    int ty[P][4], tx[P][4]; // 4 taps per neighbour
+    int tw[P][4];           // their weights, sum up to 256
+
+    FeatureLbpT()
     {
-        Mat_<uchar> feature(I.size(),0);
-        Mat_<uchar> img(I);
-        const int R=radius;
-        for (int r=R; r<img.rows-R; r++)
+        for (int k=0; k<P; k++)
         {
-            for (int c=R; c<img.cols-R; c++)
+            double a = 2.0*CV_PI*k/P;
+            double x = R*sin(a), y = -R*cos(a);
+            if (!Interp)
             {
-                uchar v = 0;
-                v |= (img(r-R,c  ) > img(r  ,c+R)) << 0;
-                v |= (img(r  ,c+R) > img(r+R,c  )) << 1;
-                v |= (img(r+R,c  ) > img(r  ,c-R)) << 2;
-                v |= (img(r  ,c-R) > img(r-R,c  )) << 3;
-                feature(r,c) = v;
+                double m = std::max(fabs(x), fabs(y));
+                x = cvRound(x*R/m);
+                y = cvRound(y*R/m);
             }
+            if (fabs(x-cvRound(x)) < 1e-6) x = cvRound(x);
+            if (fabs(y-cvRound(y)) < 1e-6) y = cvRound(y);
+            int x0 = cvFloor(x), y0 = cvFloor(y);
+            double fx = x-x0, fy = y-y0;
+            int x1 = (fx>0) ? x0+1 : x0;
+            int y1 = (fy>0) ? y0+1 : y0;
+            int w1 = cvRound(fx*(1-fy)*256);
+            int w2 = cvRound((1-fx)*fy*256);
+            int w3 = cvRound(fx*fy*256);
+            tx[k][0] = x0; ty[k][0] = y0; tw[k][0] = 256-w1-w2-w3;
+            tx[k][1] = x1; ty[k][1] = y0; tw[k][1] = w1;
+            tx[k][2] = x0; ty[k][2] = y1; tw[k][2] = w2;
+            tx[k][3] = x1; ty[k][3] = y1; tw[k][3] = w3;
+        }
+    }
+
+    int bins() const   { return 1<<B; }
+    int border() const { return R; }
+
+    // the other side of comparison k
+    static int other(int k) { return (Cmp==LBP_SYM) ? k+P/2 : (k+1)%P; }
+
+    template <class V>
+    typename V::T tap(const uchar *p, int st, int k) const
+    {
+        return V::load(p + ty[k][0]*st + tx[k][0]);
+    }
+    template <class V>
+    typename V::W sample(const uchar *p, int st, int k) const
+    {
+        typename V::W s = V::mul(V::load(p + ty[k][0]*st + tx[k][0]), tw[k][0]);
+        for (int t=1; t<4; t++)
+            s = V::add(s, V::mul(V::load(p + ty[k][t]*st + tx[k][t]), tw[k][t]));
+        return s;
+    }
+
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        typename V::T v = V::zero();
+        for (int k=0; k<B; k++)
+        {
+            typename V::T m;
+            if (Interp)
+                m = V::gt(sample<V>(p,st,k), (Cmp==LBP_CENTER) ? V::mul(V::load(p),256) : sample<V>(p,st,other(k)));
+            else
+                m = V::gt(tap<V>(p,st,k), (Cmp==LBP_CENTER) ? V::load(p) : tap<V>(p,st,other(k)));
+            v = V::put(v, m, k);
         }
-        fI = feature;
-        return 16;
+        return v;
+    }
+
+    // 256 * the value at neighbour k
+    int sample(const uchar *p, int st, int k) const
+    {
+        if (!Interp)
+            return p[ty[k][0]*st + tx[k][0]] << 8;
+        int s = 0;
+        for (int t=0; t<4; t++)
+            s += tw[k][t] * p[ty[k][t]*st + tx[k][t]];
+        return s;
+    }
+
+    uchar code(const Mat_<uchar> &img, int r, int c) const
+    {
+        const uchar *p = img.ptr<uchar>(r) + c;
+        const int st = (int)img.step;
+        uchar v = 0;
+        for (int k=0; k<B; k++)
+        {
+            int b = (Cmp==LBP_CENTER) ? (p[0] << 8) : sample(p,st,other(k));
+            v |= (sample(p,st,k) > b) << k;
+        }
+        return v;
+    }
+
+    int operator() (const Mat &I, Mat &fI) const
+    {
+        return code_image(*this, I, fI);
     }
 };
 
+//
+// the classic 3x3 one.
+//
+struct FeatureLbp : public FeatureLbpT<8,1> {};
+
+//
+// "Description of Interest Regions with Center-Symmetric Local Binary Patterns"
+// (http://www.ee.oulu.fi/mvg/files/pdf/pdf_750.pdf).
+//    (w/o threshold)
+//
+template <int R>
+struct FeatureCsLbp : public FeatureLbpT<8,R,false,LBP_SYM> {};
+
+
+//
+// / \
+// \ /
+//
+template <int R>
+struct FeatureDiamondLbp : public FeatureLbpT<4,R,false,LBP_RING> {};
+
 
 //  _ _
 // |   |
 // |_ _|
 //
+template <int R>
 struct FeatureSquareLbp
 {
-    int radius;
-    FeatureSquareLbp(int r=1) : radius(r) {}
+    int bins() const   { return 16; }
+    int border() const { return R; }
+
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        const int S=R*st;
+        typename V::T v = V::zero();
+        v = V::put(v, V::gt(V::load(p-S-R), V::load(p-S+R)), 0);
+        v = V::put(v, V::gt(V::load(p-S+R), V::load(p+S+R)), 1);
+        v = V::put(v, V::gt(V::load(p+S+R), V::load(p+S-R)), 2);
+        v = V::put(v, V::gt(V::load(p+S-R), V::load(p-S-R)), 3);
+        return v;
+    }
+
+    uchar code(const Mat_<uchar> &img, int r, int c) const
+    {
+        uchar v = 0;
+        v |= (img(r-R,c-R) > img(r-R,c+R)) << 0;
+        v |= (img(r-R,c+R) > img(r+R,c+R)) << 1;
+        v |= (img(r+R,c+R) > img(r+R,c-R)) << 2;
+        v |= (img(r+R,c-R) > img(r-R,c-R)) << 3;
+        return v;
+    }
+
     int operator() (const Mat &I, Mat &fI) const
     {
-        Mat_<uchar> feature(I.size(),0);
-        Mat_<uchar> img(I);
-        const int R=radius;
-        for (int r=R; r<img.rows-R; r++)
-        {
-            for (int c=R; c<img.cols-R; c++)
-            {
-                uchar v = 0;
-                v |= (img(r-R,c-R) > img(r-R,c+R)) << 0;
-                v |= (img(r-R,c+R) > img(r+R,c+R)) << 1;
-                v |= (img(r+R,c+R) > img(r+R,c-R)) << 2;
-                v |= (img(r+R,c-R) > img(r-R,c-R)) << 3;
-                feature(r,c) = v;
-            }
-        }
-        fI = feature;
-        return 16;
+        return code_image(*this, I, fI);
     }
 };
 
@@ -216,26 +599,34 @@ struct FeatureSquareLbp
 //
 struct FeatureMTS
 {
+    int bins() const   { return 16; }
+    int border() const { return 1; }
+
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        typename V::T cen = V::load(p), v = V::zero();
+        v = V::put(v, V::gt(V::load(p-st  ), cen), 0);
+        v = V::put(v, V::gt(V::load(p-st+1), cen), 1);
+        v = V::put(v, V::gt(V::load(p   +1), cen), 2);
+        v = V::put(v, V::gt(V::load(p+st+1), cen), 3);
+        return v;
+    }
+
+    uchar code(const Mat_<uchar> &img, int r, int c) const
+    {
+        uchar v = 0;
+        uchar cen = img(r,c);
+        v |= (img(r-1,c  ) > cen) << 0;
+        v |= (img(r-1,c+1) > cen) << 1;
+        v |= (img(r  ,c+1) > cen) << 2;
+        v |= (img(r+1,c+1) > cen) << 3;
+        return v;
+    }
+
     int operator () (const Mat &I, Mat &fI) const
     {
-        Mat_<uchar> img(I);
-        Mat_<uchar> fea(I.size(), 0);
-        const int m=1;
-        for (int r=m; r<img.rows-m; r++)
-        {
-            for (int c=m; c<img.cols-m; c++)
-            {
-                uchar v = 0;
-                uchar cen = img(r,c);
-                v |= (img(r-1,c  ) > cen) << 0;
-                v |= (img(r-1,c+1) > cen) << 1;
-                v |= (img(r  ,c+1) > cen) << 2;
-                v |= (img(r+1,c+1) > cen) << 3;
-                fea(r,c) = v;
-            }
-        }
-        fI = fea;
-        return 16;
+        return code_image(*this, I, fI);
     }
 };
 
@@ -245,29 +636,41 @@ struct FeatureMTS
 //
 struct FeatureBGC1
 {
+    int bins() const   { return 256; }
+    int border() const { return 1; }
+
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        typename V::T v = V::zero();
+        v = V::put(v, V::gt(V::load(p-st  ), V::load(p-st-1)), 0);
+        v = V::put(v, V::gt(V::load(p-st+1), V::load(p-st  )), 1);
+        v = V::put(v, V::gt(V::load(p   +1), V::load(p-st+1)), 2);
+        v = V::put(v, V::gt(V::load(p+st+1), V::load(p   +1)), 3);
+        v = V::put(v, V::gt(V::load(p+st  ), V::load(p+st+1)), 4);
+        v = V::put(v, V::gt(V::load(p+st-1), V::load(p+st  )), 5);
+        v = V::put(v, V::gt(V::load(p   -1), V::load(p+st-1)), 6);
+        v = V::put(v, V::gt(V::load(p-st-1), V::load(p   -1)), 7);
+        return v;
+    }
+
+    uchar code(const Mat_<uchar> &img, int r, int c) const
+    {
+        uchar v = 0;
+        v |= (img(r-1,c  ) > img(r-1,c-1)) << 0;
+        v |= (img(r-1,c+1) > img(r-1,c  )) << 1;
+        v |= (img(r  ,c+1) > img(r-1,c+1)) << 2;
+        v |= (img(r+1,c+1) > img(r  ,c+1)) << 3;
+        v |= (img(r+1,c  ) > img(r+1,c+1)) << 4;
+        v |= (img(r+1,c-1) > img(r+1,c  )) << 5;
+        v |= (img(r  ,c-1) > img(r+1,c-1)) << 6;
+        v |= (img(r-1,c-1) > img(r  ,c-1)) << 7;
+        return v;
+    }
+
     int operator () (const Mat &I, Mat &fI) const
     {
-        Mat_<uchar> feature(I.size(),0);
-        Mat_<uchar> img(I);
-        const int m=1;
-        for (int r=m; r<img.rows-m; r++)
-        {
-            for (int c=m; c<img.cols-m; c++)
-            {
-                uchar v = 0;
-                v |= (img(r-1,c  ) > img(r-1,c-1)) << 0;
-                v |= (img(r-1,c+1) > img(r-1,c  )) << 1;
-                v |= (img(r  ,c+1) > img(r-1,c+1)) << 2;
-                v |= (img(r+1,c+1) > img(r  ,c+1)) << 3;
-                v |= (img(r+1,c  ) > img(r+1,c+1)) << 4;
-                v |= (img(r+1,c-1) > img(r+1,c  )) << 5;
-                v |= (img(r  ,c-1) > img(r+1,c-1)) << 6;
-                v |= (img(r-1,c-1) > img(r  ,c-1)) << 7;
-                feature(r,c) = v;
-            }
-        }
-        fI = feature;
-        return 256;
+        return code_image(*this, I, fI);
     }
 };
 
@@ -279,29 +682,42 @@ struct FeatureBGC1
 //
 struct FeatureTPLbp
 {
+    int bins() const   { return 256; }
+    int border() const { return 2; }
+
+    // (I(r,c) - a) > (I(r,c) - b)  <==>  b > a
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        typename V::T v = V::zero();
+        v = V::put(v, V::gt(V::load(p-2*st), V::load(p   -2)), 0);
+        v = V::put(v, V::gt(V::load(p-st+1), V::load(p-st-1)), 1);
+        v = V::put(v, V::gt(V::load(p   +2), V::load(p-2*st)), 2);
+        v = V::put(v, V::gt(V::load(p+st+1), V::load(p-st+1)), 3);
+        v = V::put(v, V::gt(V::load(p+st  ), V::load(p   +2)), 4);
+        v = V::put(v, V::gt(V::load(p+st-1), V::load(p+st+1)), 5);
+        v = V::put(v, V::gt(V::load(p   -2), V::load(p+st  )), 6);
+        v = V::put(v, V::gt(V::load(p-st-1), V::load(p+st-1)), 7);
+        return v;
+    }
+
+    uchar code(const Mat_<uchar> &I, int r, int c) const
+    {
+        uchar v = 0;
+        v |= ((I(r,c) - I(r  ,c-2)) > (I(r,c) - I(r-2,c  ))) * 1;
+        v |= ((I(r,c) - I(r-1,c-1)) > (I(r,c) - I(r-1,c+1))) * 2;
+        v |= ((I(r,c) - I(r-2,c  )) > (I(r,c) - I(r  ,c+2))) * 4;
+        v |= ((I(r,c) - I(r-1,c+1)) > (I(r,c) - I(r+1,c+1))) * 8;
+        v |= ((I(r,c) - I(r  ,c+2)) > (I(r,c) - I(r+1,c  ))) * 16;
+        v |= ((I(r,c) - I(r+1,c+1)) > (I(r,c) - I(r+1,c-1))) * 32;
+        v |= ((I(r,c) - I(r+1,c  )) > (I(r,c) - I(r  ,c-2))) * 64;
+        v |= ((I(r,c) - I(r+1,c-1)) > (I(r,c) - I(r-1,c-1))) * 128;
+        return v;
+    }
+
     int operator () (const Mat &img, Mat &features) const
     {
-        Mat_<uchar> I(img);
-        Mat_<uchar> fI(I.size(), 0);
-        const int R=2;
-        for (int r=R; r<I.rows-R; r++)
-        {
-            for (int c=R; c<I.cols-R; c++)
-            {
-                uchar v = 0;
-                v |= ((I(r,c) - I(r  ,c-2)) > (I(r,c) - I(r-2,c  ))) * 1;
-                v |= ((I(r,c) - I(r-1,c-1)) > (I(r,c) - I(r-1,c+1))) * 2;
-                v |= ((I(r,c) - I(r-2,c  )) > (I(r,c) - I(r  ,c+2))) * 4;
-                v |= ((I(r,c) - I(r-1,c+1)) > (I(r,c) - I(r+1,c+1))) * 8;
-                v |= ((I(r,c) - I(r  ,c+2)) > (I(r,c) - I(r+1,c  ))) * 16;
-                v |= ((I(r,c) - I(r+1,c+1)) > (I(r,c) - I(r+1,c-1))) * 32;
-                v |= ((I(r,c) - I(r+1,c  )) > (I(r,c) - I(r  ,c-2))) * 64;
-                v |= ((I(r,c) - I(r+1,c-1)) > (I(r,c) - I(r-1,c-1))) * 128;
-                fI(r,c) = v;
-            }
-        }
-        features = fI;
-        return 256;
+        return code_image(*this, img, features);
     }
 };
 
@@ -316,25 +732,35 @@ struct FeatureFPLbp
     int radius;
     FeatureFPLbp(int r=2) : radius(r) {}
 
-    int operator () (const Mat &img, Mat &features) const
+    int bins() const   { return 16; }
+    int border() const { return radius; }
+
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        const int R=radius, S=radius*st;
+        typename V::T v = V::zero();
+        v = V::put(v, V::gt_diff(V::load(p   +1), V::load(p+S+R), V::load(p   -1), V::load(p-S-R)), 0);
+        v = V::put(v, V::gt_diff(V::load(p+st+1), V::load(p+S  ), V::load(p-st-1), V::load(p-S  )), 1);
+        v = V::put(v, V::gt_diff(V::load(p+st  ), V::load(p+S-R), V::load(p-st  ), V::load(p-S+R)), 2);
+        v = V::put(v, V::gt_diff(V::load(p+st-1), V::load(p  -R), V::load(p-st+1), V::load(p  +R)), 3);
+        return v;
+    }
+
+    uchar code(const Mat_<uchar> &I, int r, int c) const
     {
-        Mat_<uchar> I(img);
-        Mat_<uchar> fI(I.size(), 0);
         const int R=radius;
-        for (int r=R; r<I.rows-R; r++)
-        {
-            for (int c=R; c<I.cols-R; c++)
-            {
-                uchar v = 0;
-                v |= ((I(r  ,c+1) - I(r+R,c+R)) > (I(r  ,c-1) - I(r-R,c-R))) * 1;
-                v |= ((I(r+1,c+1) - I(r+R,c  )) > (I(r-1,c-1) - I(r-R,c  ))) * 2;
-                v |= ((I(r+1,c  ) - I(r+R,c-R)) > (I(r-1,c  ) - I(r-R,c+R))) * 4;
-                v |= ((I(r+1,c-1) - I(r  ,c-R)) > (I(r-1,c+1) - I(r  ,c+R))) * 8;
-                fI(r,c) = v;
-            }
-        }
-        features = fI;
-        return 16;
+        uchar v = 0;
+        v |= ((I(r  ,c+1) - I(r+R,c+R)) > (I(r  ,c-1) - I(r-R,c-R))) * 1;
+        v |= ((I(r+1,c+1) - I(r+R,c  )) > (I(r-1,c-1) - I(r-R,c  ))) * 2;
+        v |= ((I(r+1,c  ) - I(r+R,c-R)) > (I(r-1,c  ) - I(r-R,c+R))) * 4;
+        v |= ((I(r+1,c-1) - I(r  ,c-R)) > (I(r-1,c+1) - I(r  ,c+R))) * 8;
+        return v;
+    }
+
+    int operator () (const Mat &img, Mat &features) const
+    {
+        return code_image(*this, img, features);
     }
 };
 
@@ -342,48 +768,185 @@ struct FeatureFPLbp
 
 
 
-static void hist_patch(const Mat_<uchar> &fI, Mat &histo, int histSize=256)
+//
+// count the codes of a patch into histSize floats of a preallocated feature row.
+//   4 interleaved sub-histograms keep runs of equal codes from stalling
+//   on the same counter, they get merged (and converted) once at the end.
+//
+static void hist_patch(const Mat_<uchar> &fI, float *histo, int histSize=256)
 {
-    Mat_<float> h(1, histSize, 0.0f);
+    CV_Assert(histSize <= 256); // codes are bytes, so are the counters
+    unsigned h[4][256];
+    for (int k=0; k<4; k++)
+        memset(h[k], 0, histSize*sizeof(unsigned));
     for (int i=0; i<fI.rows; i++)
     {
-        for (int j=0; j<fI.cols; j++)
+        const uchar *p = fI.ptr<uchar>(i);
+        int j=0;
+        for (; j<fI.cols-3; j+=4)
         {
-            int v = int(fI(i,j));
-            h( v ) += 1.0f;
+            h[0][p[j  ]]++;
+            h[1][p[j+1]]++;
+            h[2][p[j+2]]++;
+            h[3][p[j+3]]++;
         }
+        for (; j<fI.cols; j++)
+            h[0][p[j]]++;
     }
-    histo.push_back(h.reshape(1,1));
+    for (int b=0; b<histSize; b++)
+        histo[b] = float(h[0][b] + h[1][b] + h[2][b] + h[3][b]);
 }
 
 
-static void hist_patch_uniform(const Mat_<uchar> &fI, Mat &histo)
-{
-    static int uniform[256] =
-    {   // the well known original uniform2 pattern
-        0,1,2,3,4,58,5,6,7,58,58,58,8,58,9,10,11,58,58,58,58,58,58,58,12,58,58,58,13,58,
-        14,15,16,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,17,58,58,58,58,58,58,58,18,
-        58,58,58,19,58,20,21,22,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,
-        58,58,58,58,58,58,58,58,58,58,58,58,23,58,58,58,58,58,58,58,58,58,58,58,58,58,
-        58,58,24,58,58,58,58,58,58,58,25,58,58,58,26,58,27,28,29,30,58,31,58,58,58,32,58,
-        58,58,58,58,58,58,33,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,34,58,58,58,58,
-        58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,
-        58,35,36,37,58,38,58,58,58,39,58,58,58,58,58,58,58,40,58,58,58,58,58,58,58,58,58,
-        58,58,58,58,58,58,41,42,43,58,44,58,58,58,45,58,58,58,58,58,58,58,46,47,48,58,49,
-        58,58,58,50,51,52,58,53,54,55,56,57
+static const uchar uniform_lut[256] =
+{   // the well known original uniform2 pattern
+    0,1,2,3,4,58,5,6,7,58,58,58,8,58,9,10,11,58,58,58,58,58,58,58,12,58,58,58,13,58,
+    14,15,16,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,17,58,58,58,58,58,58,58,18,
+    58,58,58,19,58,20,21,22,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,
+    58,58,58,58,58,58,58,58,58,58,58,58,23,58,58,58,58,58,58,58,58,58,58,58,58,58,
+    58,58,24,58,58,58,58,58,58,58,25,58,58,58,26,58,27,28,29,30,58,31,58,58,58,32,58,
+    58,58,58,58,58,58,33,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,34,58,58,58,58,
+    58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,58,
+    58,35,36,37,58,38,58,58,58,39,58,58,58,58,58,58,58,40,58,58,58,58,58,58,58,58,58,
+    58,58,58,58,58,58,41,42,43,58,44,58,58,58,45,58,58,58,58,58,58,58,46,47,48,58,49,
+    58,58,58,50,51,52,58,53,54,55,56,57
+};
+
+//
+// emits the uniform pattern index of a 256 bin feature's codes directly,
+//   (58 uniform patterns + 1 for all others, in the same 60 bins as PyramidGrid(true))
+//   so the grid can histogram them as they are.
+//
+template <class Feature>
+struct FeatureUniform : public Feature
+{
+    int bins() const { return 60; }
+
+    // a 256 entry table does not fit a byte shuffle (16 entries), and a 16 step
+    //   nibble-shuffle was slower than the lookup from L1, while the codes are still hot.
+    template <class V>
+    typename V::T codes(const uchar *p, int st) const
+    {
+        uchar b[V::N];
+        V::store(b, Feature::template codes<V>(p, st));
+        for (int i=0; i<V::N; i++)
+            b[i] = uniform_lut[b[i]];
+        return V::load(b);
+    }
+
+    uchar code(const Mat_<uchar> &img, int r, int c) const
+    {
+        return uniform_lut[Feature::code(img, r, c)];
+    }
+
+    int operator() (const Mat &I, Mat &fI) const
+    {
+        return code_image(*this, I, fI);
+    }
+};
+
+
+//
+// maps image rows/cols to the cells of one or more (overlapping) grid levels,
+//   so all cell histograms can be accumulated in a single sweep over the image.
+//   per level, cells are ordered column-major (i*gridy+j), pixels outside grid*cellsize are skipped.
+//
+struct GridCells
+{
+    struct Level
+    {
+        int off, ncols;
+        vector<int> ox; // per col: hist offset of the cell column
+        vector<int> oy; // per row: hist offset of the cell row, or -1
     };
+    vector<Level> levels;
+    int histSize, total;
 
-    Mat_<float> h(1, 60, 0.0f); // mod4
-    for (int i=0; i<fI.rows; i++)
+    GridCells(Size siz, const int *gridx, const int *gridy, int nlevels, int histSize)
+        : levels(nlevels)
+        , histSize(histSize)
+        , total(0)
     {
-        for (int j=0; j<fI.cols; j++)
+        for (int l=0; l<nlevels; l++)
         {
-            int v = int(fI(i,j));
-            h( uniform[v] ) += 1.0f;
+            Level &L = levels[l];
+            int sw = siz.width/gridx[l];
+            int sh = siz.height/gridy[l];
+            L.off = total;
+            L.ncols = sw*gridx[l];
+            L.ox.resize(L.ncols);
+            for (int c=0; c<L.ncols; c++)
+                L.ox[c] = (c/sw) * gridy[l] * histSize;
+            L.oy.assign(siz.height, -1);
+            for (int r=0; r<sh*gridy[l]; r++)
+                L.oy[r] = L.off + (r/sh) * histSize;
+            total += gridx[l] * gridy[l] * histSize;
+        }
+    }
+
+    // add a row of codes to all cells it falls into
+    void add(int *h, int r, const uchar *codes) const
+    {
+        for (size_t l=0; l<levels.size(); l++)
+        {
+            const Level &L = levels[l];
+            if (L.oy[r] < 0)
+                continue;
+            int *hr = h + L.oy[r];
+            const int *ox = &L.ox[0];
+            for (int c=0; c<L.ncols; c++)
+            {
+                hr[ox[c] + codes[c]] ++;
+            }
         }
     }
-    histo.push_back(h.reshape(1,1));
-}
+
+    // histogram an existing code image, each pixel is read only once
+    void hist(const Mat &feature, Mat &histo, const uchar *lut=0) const
+    {
+        Mat_<uchar> fI(feature);
+        vector<int> h(total, 0);
+        vector<uchar> codes(fI.cols);
+        for (int r=0; r<fI.rows; r++)
+        {
+            const uchar *row = fI.ptr<uchar>(r);
+            if (lut)
+            {
+                for (int c=0; c<fI.cols; c++)
+                    codes[c] = lut[row[c]];
+                row = &codes[0];
+            }
+            add(&h[0], r, row);
+        }
+        finish(h, histo);
+    }
+
+    // compute the codes row by row, and histogram them in place (no code image)
+    template <class Feature>
+    void fused(const Feature &ext, const Mat &I, Mat &histo, const uchar *lut=0) const
+    {
+        Mat_<uchar> img(I);
+        vector<int> h(total, 0);
+        vector<uchar> codes(img.cols);
+        for (int r=0; r<img.rows; r++)
+        {
+            code_row(ext, img, r, &codes[0]);
+            if (lut)
+            {
+                for (int c=0; c<img.cols; c++)
+                    codes[c] = lut[codes[c]];
+            }
+            add(&h[0], r, &codes[0]);
+        }
+        finish(h, histo);
+    }
+
+    static void finish(const vector<int> &h, Mat &histo)
+    {
+        Mat(h).convertTo(histo, CV_32F);
+        normalize(histo.reshape(1,1), histo);
+    }
+};
 
 
 struct GriddedHist
@@ -395,20 +958,20 @@ struct GriddedHist
         , GRIDY(gridy)
     {}
 
+    GridCells cells(Size siz, int histSize) const
+    {
+        return GridCells(siz, &GRIDX, &GRIDY, 1, histSize);
+    }
+
     void hist(const Mat &feature, Mat &histo, int histSize=256) const
     {
-        histo.release();
-        int sw = feature.cols/GRIDX;
-        int sh = feature.rows/GRIDY;
-        for (int i=0; i<GRIDX; i++)
-        {
-            for (int j=0; j<GRIDY; j++)
-            {
-                Mat patch(feature, Range(j*sh,(j+1)*sh), Range(i*sw,(i+1)*sw));
-                hist_patch(patch, histo, histSize);
-            }
-        }
-        normalize(histo.reshape(1,1),histo);
+        cells(feature.size(), histSize).hist(feature, histo);
+    }
+
+    template <class Feature>
+    void fused(const Feature &ext, const Mat &img, Mat &histo) const
+    {
+        cells(img.size(), ext.bins()).fused(ext, img, histo);
     }
 };
 
@@ -416,6 +979,7 @@ struct GriddedHist
 //
 // overlapped pyramid of histogram patches
 //  (not resizing the feature/image)
+//  all 4 levels are gathered in one sweep over the feature.
 //
 struct PyramidGrid
 {
@@ -423,56 +987,112 @@ struct PyramidGrid
 
     PyramidGrid(bool uniform=false): uniform(uniform) {}
 
-    void hist_level(const Mat &feature, Mat &histo, int GRIDX, int GRIDY,int histSize=256) const
+    GridCells cells(Size siz, int histSize) const
     {
-        int sw = feature.cols/GRIDX;
-        int sh = feature.rows/GRIDY;
-        for (int i=0; i<GRIDX; i++)
-        {
-            for (int j=0; j<GRIDY; j++)
-            {
-                Mat patch(feature, Range(j*sh,(j+1)*sh), Range(i*sw,(i+1)*sw));
-                if (uniform && histSize==256)
-                    hist_patch_uniform(patch, histo);
-                else
-                    hist_patch(patch, histo, histSize);
-            }
-        }
+        int levels[] = {5,6,7,8};
+        return GridCells(siz, levels, levels, 4, histSize);
+    }
+
+    void hist(const Mat &feature, Mat &histo, int histSize=256) const
+    {
+        bool uni = uniform && histSize==256;
+        cells(feature.size(), uni ? 60 : histSize).hist(feature, histo, uni ? uniform_lut : 0);
+    }
+
+    template <class Feature>
+    void fused(const Feature &ext, const Mat &img, Mat &histo) const
+    {
+        bool uni = uniform && ext.bins()==256;
+        cells(img.size(), uni ? 60 : ext.bins()).fused(ext, img, histo, uni ? uniform_lut : 0);
+    }
+};
+
+
+
+//
+// heavy, read-only assets (landmark models, pca banks) are loaded once per process,
+//   on first use, and shared by all extractors that ask for the same file (and node).
+//   an Asset needs a default constructor, and a load(file, node) method.
+//
+static Mutex asset_mutex;
+
+template <class Asset>
+static Ptr<Asset> shared_asset(const String &file, const String &node=String())
+{
+    AutoLock lock(asset_mutex);
+    static std::map<String, Ptr<Asset> > assets;
+    Ptr<Asset> &asset = assets[file + "#" + node];
+    if (asset.empty())
+    {
+        Ptr<Asset> a = makePtr<Asset>();
+        a->load(file, node); // if this throws, the next one tries again
+        asset = a;
+    }
+    return asset;
+}
+
+
+//
+// various attempts to gather landmarks for sampling,
+//   picked at runtime (see setLandmarks()), one shared instance per kind.
+//   each one keeps its per-call latency (per thread, summed up on request).
+//
+struct LandMarkTiming
+{
+    int64 ticks;
+    int calls;
+    LandMarkTiming() : ticks(0), calls(0) {}
+};
+
+struct LandMarkBackend
+{
+    TLSData<LandMarkTiming> timing;
+
+    virtual ~LandMarkBackend() {}
+    virtual int detect(const Mat &img, vector<Point> &kp) const = 0;
+    virtual bool expensive() const { return true; } // worth a LandMarkCache lookup
+
+    int extract(const Mat &img, vector<Point> &kp) const
+    {
+        int64 t0 = getTickCount();
+        int n = detect(img, kp);
+        LandMarkTiming *t = timing.get();
+        t->ticks += getTickCount() - t0;
+        t->calls ++;
+        return n;
     }
 
-    void hist(const Mat &feature, Mat &histo, int histSize=256) const
+    // mean milliseconds per call, over all threads
+    double latency(int &calls) const
     {
-        histo.release();
-        int levels[] = {5,6,7,8};
-        for (int i=0; i<4; i++)
+        vector<LandMarkTiming*> all;
+        timing.gather(all);
+        int64 ticks = 0;
+        calls = 0;
+        for (size_t i=0; i<all.size(); i++)
         {
-            hist_level(feature,histo,levels[i],levels[i],histSize);
+            ticks += all[i]->ticks;
+            calls += all[i]->calls;
         }
-        normalize(histo.reshape(1,1),histo);
+        return calls ? 1000.0 * ticks / getTickFrequency() / calls : 0;
     }
 };
 
-
-
-//
-// various attempts to gather landmarks for sampling
-//
-
 #ifdef HAVE_DLIB
 //
 // 20 assorted keypoints extracted from the 68 dlib facial landmarks, based on the
 //    Kazemi_One_Millisecond_Face_2014_CVPR_paper.pdf
 //
-struct LandMarks
+struct LandMarksDlib : public LandMarkBackend
 {
     dlib::shape_predictor sp;
 
-    LandMarks()
+    void load(const String &file, const String &)
     {   // it's only 95mb...
-        dlib::deserialize("data/shape_predictor_68_face_landmarks.dat") >> sp;
+        dlib::deserialize(file) >> sp;
     }
 
-    int extract(const Mat &img, vector<Point> &kp) const
+    virtual int detect(const Mat &img, vector<Point> &kp) const
     {
         dlib::rectangle rec(0,0,img.cols,img.rows);
         dlib::full_object_detection shape = sp(dlib::cv_image<uchar>(img), rec);
@@ -497,29 +1117,37 @@ struct LandMarks
         return (int)kp.size();
     }
 };
-#elif 0
-struct LandMarks
+#endif
+
+struct LandMarksElastic : public LandMarkBackend
 {
     Ptr<ElasticParts> elastic;
 
-    LandMarks()
+    void load(const String &file, const String &kind)
     {
-        elastic = ElasticParts::createDiscriminative();
-        elastic->read("data/disc.xml.gz");
-        //elastic = ElasticParts::createGenerative();
-        //elastic->read("data/parts.xml.gz");
+        elastic = (kind == "generative") ? ElasticParts::createGenerative() : ElasticParts::createDiscriminative();
+        bool ok = elastic->read(file);
+        CV_Assert(ok); // a missing model must not be kept as an empty one
     }
 
-    int extract(const Mat &img, vector<Point> &kp) const
+    virtual int detect(const Mat &img, vector<Point> &kp) const
     {
         elastic->getPoints(img, kp);
         return (int)kp.size();
     }
 };
-#else
-struct LandMarks
+
+//
+// 'one-size-fits-all' set of points (based on the mean lfw image),
+//   good enough for aligned (e.g. frontalized) crops.
+//
+struct LandMarksFixed : public LandMarkBackend
 {
-    int extract(const Mat &img, vector<Point> &kp) const
+    void load(const String &, const String &) {}
+
+    virtual bool expensive() const { return false; } // not worth a hash
+
+    virtual int detect(const Mat &img, vector<Point> &kp) const
     {
         kp.push_back(Point(15,19));    kp.push_back(Point(75,19));
         kp.push_back(Point(29,20));    kp.push_back(Point(61,20));
@@ -544,8 +1172,183 @@ struct LandMarks
         return (int)kp.size();
     }
 };
+
+//
+// the backend of that kind, loaded on first use. dlib needs HAVE_DLIB,
+//   the elastic ones a trained model in data/.
+//
+static Ptr<LandMarkBackend> landmark_backends[LAND_MAX]; // the ones in use, for the latency report
+
+static Ptr<LandMarkBackend> landmark_backend(int land)
+{
+    Ptr<LandMarkBackend> b;
+    switch(land)
+    {
+#ifdef HAVE_DLIB
+        case LAND_DLIB:        b = shared_asset<LandMarksDlib>("data/shape_predictor_68_face_landmarks.dat"); break;
+#endif
+        case LAND_ELASTIC:     b = shared_asset<LandMarksElastic>("data/disc.xml.gz", "discriminative"); break;
+        case LAND_ELASTIC_GEN: b = shared_asset<LandMarksElastic>("data/parts.xml.gz", "generative"); break;
+        case LAND_FIXED:       b = shared_asset<LandMarksFixed>("fixed"); break;
+        default: cerr << "landmarks " << land << " are not supported, using fixed ones." << endl;
+                 return landmark_backend(LAND_FIXED);
+    }
+    AutoLock lock(asset_mutex);
+    landmark_backends[land] = b;
+    return b;
+}
+
+//
+// the kind new LandMarks use: the calling thread's choice (inside createExtractor(ext,land)),
+//   else the process wide one.
+//
+#ifdef HAVE_DLIB
+static int landmark_default = LAND_DLIB;
+#else
+static int landmark_default = LAND_FIXED;
 #endif
 
+struct LandMarkChoice
+{
+    int land;
+    LandMarkChoice() : land(-1) {}
+};
+static TLSData<LandMarkChoice> landmark_choice;
+
+// sets the calling thread's choice, as long as it lives
+struct LandMarkChoiceScope
+{
+    int prev;
+
+    LandMarkChoiceScope(int land) : prev(landmark_choice.get()->land)
+    {
+        landmark_choice.get()->land = land;
+    }
+    ~LandMarkChoiceScope()
+    {
+        landmark_choice.get()->land = prev;
+    }
+};
+
+static int landmark_kind()
+{
+    int land = landmark_choice.get()->land;
+    return land >= 0 ? land : landmark_default;
+}
+
+//
+// the landmarks of recently seen images, keyed by content (fnv-1a of the pixels,
+//   plus size and type) and backend, least recently used ones are dropped first.
+//   (a duel re-extracts the same images on every fold)
+//
+struct LandMarkCache
+{
+    struct Key
+    {
+        uint64 hash;
+        int rows, cols, type, land;
+
+        bool operator < (const Key &k) const
+        {
+            if (hash != k.hash) return hash < k.hash;
+            if (land != k.land) return land < k.land;
+            if (rows != k.rows) return rows < k.rows;
+            if (cols != k.cols) return cols < k.cols;
+            return type < k.type;
+        }
+    };
+    typedef std::list< std::pair<Key, vector<Point> > > Lru; // most recent first
+
+    Lru lru;
+    std::map<Key, Lru::iterator> index;
+    size_t capacity;
+    Mutex mutex;
+
+    LandMarkCache(size_t capacity) : capacity(capacity) {}
+
+    static Key key(const Mat &img, int land)
+    {
+        Key k;
+        k.land = land;
+        k.hash = 14695981039346656037ULL;
+        k.rows = img.rows;
+        k.cols = img.cols;
+        k.type = img.type();
+        size_t n = img.cols * img.elemSize();
+        for (int r=0; r<img.rows; r++)
+        {
+            const uchar *p = img.ptr<uchar>(r);
+            for (size_t i=0; i<n; i++)
+                k.hash = (k.hash ^ p[i]) * 1099511628211ULL;
+        }
+        return k;
+    }
+
+    bool get(const Key &k, vector<Point> &kp)
+    {
+        AutoLock lock(mutex);
+        std::map<Key, Lru::iterator>::iterator it = index.find(k);
+        if (it == index.end())
+            return false;
+        lru.splice(lru.begin(), lru, it->second);
+        kp.insert(kp.end(), it->second->second.begin(), it->second->second.end());
+        return true;
+    }
+
+    void put(const Key &k, const vector<Point> &kp)
+    {
+        AutoLock lock(mutex);
+        if (index.find(k) != index.end())
+            return; // another thread was faster
+        lru.push_front(std::make_pair(k, kp));
+        index[k] = lru.begin();
+        if (lru.size() > capacity)
+        {
+            index.erase(lru.back().first);
+            lru.pop_back();
+        }
+    }
+};
+static LandMarkCache landmark_cache(4096);
+
+//
+// the backend's points for img, found once per ImageScope,
+//   and, if the backend is an expensive one, remembered by the LandMarkCache.
+//
+struct LandMarks
+{
+    int land;
+    Ptr<LandMarkBackend> backend;
+
+    LandMarks() : land(landmark_kind()), backend(landmark_backend(land)) {}
+
+    int detect(const Mat &img, vector<Point> &kp) const
+    {
+        if (!backend->expensive())
+            return backend->extract(img, kp);
+        LandMarkCache::Key k = LandMarkCache::key(img, land);
+        if (landmark_cache.get(k, kp))
+            return (int)kp.size();
+        vector<Point> pts;
+        backend->extract(img, pts);
+        landmark_cache.put(k, pts);
+        kp.insert(kp.end(), pts.begin(), pts.end());
+        return (int)kp.size();
+    }
+
+    int extract(const Mat &img, vector<Point> &kp) const
+    {
+        ImageShared *s = shared_for(img);
+        if (!s)
+            return detect(img, kp);
+        vector<Point> &pts = s->landmarks[land];
+        if (pts.empty())
+            detect(img, pts);
+        kp.insert(kp.end(), pts.begin(), pts.end());
+        return (int)kp.size();
+    }
+};
+
 
 
 
@@ -601,15 +1404,15 @@ struct GfttGrid
         //gftt96(kp);
         //kp_manual(kp);
 
-        histo.release();
+        Mat_<float> h(1, int(kp.size())*histSize);
         Rect bounds(Point(),feature.size());
         for (size_t k=0; k<kp.size(); k++)
         {
             Rect part(int(kp[k].pt.x)-gr, int(kp[k].pt.y)-gr, gr*2, gr*2);
             part &= bounds;
-            hist_patch(feature(part), histo, histSize);
+            hist_patch(feature(part), h[0] + k*histSize, histSize);
         }
-        normalize(histo.reshape(1,1),histo);
+        normalize(h, histo);
     }
 };
 
@@ -645,36 +1448,127 @@ struct GenericExtractor : public TextureFeature::Extractor
 
 
 //
-// instead of adding more bits, concatenate several histograms,
-// cslbp + dialbp + sqlbp = 3*16 bins = 12288 feature-bytes.
+// same as above, but the Feature passes its codes row by row
+//   straight into the histograms of the Grid cells, the code image is never stored.
+//   (Feature needs the border()/bins()/code() interface, Grid a fused() method)
+//   inside an ImageScope, the code image is kept instead, so other extractors
+//   on the same feature can reuse it (the histograms come out the same).
 //
-template <typename Grid>
-struct CombinedExtractor : public TextureFeature::Extractor
+template <typename Feature, typename Grid>
+struct FusedExtractor : public TextureFeature::Extractor
 {
+    Feature ext;
     Grid grid;
 
-    CombinedExtractor(const Grid &grid)
-        : grid(grid)
+    FusedExtractor(const Feature &ext, const Grid &grid)
+        : ext(ext)
+        , grid(grid)
     {}
 
-    template <class Extract>
-    void extract(const Mat &img, Mat &features, int r) const
+    // TextureFeature::Extractor
+    virtual int extract(const Mat &img, Mat &features) const
+    {
+        if (shared_for(img))
+        {
+            Mat fI;
+            int histSize = shared_code_image(ext, img, fI);
+            grid.hist(fI, features, histSize);
+        }
+        else
+            grid.fused(ext, img, features);
+        return features.total() * features.elemSize();
+    }
+};
+
+
+//
+// instead of adding more bits, concatenate several histograms,
+// cslbp + dialbp + sqlbp = 3*16 bins = 12288 feature-bytes.
+//
+struct CombinedFeatures
+{
+    FeatureCsLbp<2> cs2;
+    FeatureCsLbp<4> cs4;
+    FeatureFPLbp fp2, fp4;
+    FeatureDiamondLbp<3> dia;
+    FeatureSquareLbp<4> sq;
+
+    enum { N=6, BINS=16 };
+
+    CombinedFeatures() : fp2(2), fp4(4) {}
+
+    // one pass per feature, code image & grid histogram each
+    template <class Grid>
+    void hist(const Grid &grid, const Mat &img, Mat &features) const
+    {
+        hist(grid, img, features, cs2);
+        hist(grid, img, features, cs4);
+        hist(grid, img, features, fp2);
+        hist(grid, img, features, fp4);
+        hist(grid, img, features, dia);
+        hist(grid, img, features, sq);
+    }
+    template <class Grid, class Extract>
+    void hist(const Grid &grid, const Mat &img, Mat &features, const Extract &ext) const
     {
-        Extract ext(r);
         Mat f,fI;
         int histSize = ext(img, f);
         grid.hist(f, fI, histSize);
         features.push_back(fI.reshape(1,1));
     }
+
+    // single sweep: all 6 code rows are computed while the source rows are hot,
+    //   and go straight into their own block of cells (each normalized on its own, as above)
+    void hist(const GridCells &cells, const Mat &I, Mat &features) const
+    {
+        Mat_<uchar> img(I);
+        const int cols = img.cols;
+        vector<int> h(N*cells.total, 0);
+        vector<uchar> codes(N*cols);
+        for (int r=0; r<img.rows; r++)
+        {
+            uchar *c = &codes[0];
+            code_row(cs2, img, r, c);
+            code_row(cs4, img, r, c + 1*cols);
+            code_row(fp2, img, r, c + 2*cols);
+            code_row(fp4, img, r, c + 3*cols);
+            code_row(dia, img, r, c + 4*cols);
+            code_row(sq,  img, r, c + 5*cols);
+            for (int k=0; k<N; k++)
+                cells.add(&h[k*cells.total], r, c + k*cols);
+        }
+        features.create(1, N*cells.total, CV_32F);
+        for (int k=0; k<N; k++)
+        {
+            Mat block = features.colRange(k*cells.total, (k+1)*cells.total);
+            Mat(1, cells.total, CV_32S, &h[k*cells.total]).convertTo(block, CV_32F);
+            normalize(block, block);
+        }
+    }
+    void hist(const GriddedHist &grid, const Mat &img, Mat &features) const
+    {
+        hist(grid.cells(img.size(), BINS), img, features);
+    }
+    void hist(const PyramidGrid &grid, const Mat &img, Mat &features) const
+    {
+        hist(grid.cells(img.size(), BINS), img, features);
+    }
+};
+
+template <typename Grid>
+struct CombinedExtractor : public TextureFeature::Extractor
+{
+    Grid grid;
+    CombinedFeatures comb;
+
+    CombinedExtractor(const Grid &grid)
+        : grid(grid)
+    {}
+
     // TextureFeature::Extractor
     virtual int extract(const Mat &img, Mat &features) const
     {
-        extract<FeatureCsLbp>(img,features,2);
-        extract<FeatureCsLbp>(img,features,4);
-        extract<FeatureFPLbp>(img,features,2);
-        extract<FeatureFPLbp>(img,features,4);
-        extract<FeatureDiamondLbp>(img,features,3);
-        extract<FeatureSquareLbp>(img,features,4);
+        comb.hist(grid, img, features);
         features = features.reshape(1,1);
         return features.total() * features.elemSize();
     }
@@ -697,19 +1591,15 @@ struct GradMagExtractor : public TextureFeature::Extractor
     virtual int extract(const Mat &I, Mat &features) const
     {
         Mat fgrad, fmag;
-        Mat s1, s2, s3(I.size(), CV_32F), s4(I.size(), CV_32F);
-        Sobel(I, s1, CV_32F, 1, 0);
-        Sobel(I, s2, CV_32F, 0, 1);
+        Gradients grad(I);
 
-        fastAtan2(s1.ptr<float>(0), s2.ptr<float>(0), s3.ptr<float>(0), I.total(), true);
-        fgrad = s3 / (360/nbins);
+        fgrad = grad->angle() / (360/nbins);
         fgrad.convertTo(fgrad,CV_8U);
         Mat fg;
         grid.hist(fgrad,fg,nbins+1);
         features.push_back(fg.reshape(1,1));
 
-        magnitude(s1.ptr<float>(0), s2.ptr<float>(0), s4.ptr<float>(0), I.total());
-        normalize(s4,fmag);
+        normalize(grad->magnitude(),fmag);
         fmag.convertTo(fmag,CV_8U,nbins);
         Mat fm;
         grid.hist(fmag,fm,nbins+1);
@@ -723,6 +1613,11 @@ struct GradMagExtractor : public TextureFeature::Extractor
 //
 // 2d histogram with "rings" of magnitude and "sectors" of gradients.
 //
+// the sector is found by comparing the gradient against the sector borders
+// (sign of a cross product, after folding the lower half-plane onto the upper one),
+// the ring by comparing the squared magnitude against the squared ring radii,
+// so there's no atan, sqrt or normalization per pixel.
+//
 struct ExtractorGradBin : public TextureFeature::Extractor
 {
     int nsec,nrad,grid;
@@ -730,62 +1625,180 @@ struct ExtractorGradBin : public TextureFeature::Extractor
 
     virtual int extract(const Mat &I, Mat &features) const
     {
-        Mat s1, s2, s3(I.size(), CV_32F), s4(I.size(), CV_32F), s5;
-        Sobel(I, s1, CV_32F, 1, 0);
-        Sobel(I, s2, CV_32F, 0, 1);
-        fastAtan2(s1.ptr<float>(0), s2.ptr<float>(0), s3.ptr<float>(0), I.total(), true);
-        s3 /= (360/nsec);
+        Gradients grad(I);
+        const Mat &s1 = grad->dx();
+        const Mat &s2 = grad->dy();
+
+        // sector borders, folded into [0,180).
+        // a gradient on a border goes to the upper sector, except on the 45 degree
+        // diagonal, which fastAtan2 puts at 44.99 (and 224.99)
+        int step = 360/nsec;
+        vector<float> bc, bs;
+        vector<int> bup, bge;
+        for (int a=step; a<360; a+=step)
+        {
+            double t = (a % 180) * CV_PI / 180;
+            bc.push_back((a % 90) ? float(cos(t)) : float(cvRound(cos(t))));
+            bs.push_back((a % 90) ? float(sin(t)) : float(cvRound(sin(t))));
+            bup.push_back(a >= 180);
+            bge.push_back(a % 180 != 45);
+        }
 
-        magnitude(s1.ptr<float>(0), s2.ptr<float>(0), s4.ptr<float>(0), I.total());
-        normalize(s4,s4,nrad);
+        // ring radii relative to the L2 norm of the magnitude image:
+        //   mag*nrad/norm >= k  <=>  mag^2 >= k^2*norm^2/nrad^2
+        double sq = s1.dot(s1) + s2.dot(s2);
+        vector<float> ring;
+        for (int k=1; k<nrad; k++)
+            ring.push_back(float(sq*k*k/(nrad*nrad)));
 
         int sx = I.cols/(grid-1);
         int sy = I.rows/(grid-1);
         int nbins = nsec*nrad;
-        features = Mat(1,nbins*grid*grid,CV_32F,Scalar(0));
+        vector<int> cell(I.cols);
+        for (int j=0; j<I.cols; j++)
+            cell[j] = nbins * std::min(j/sx, grid-1);
+
+        Mat_<int> counts(1, nbins*grid*grid, 0);
+        int *cnt = counts.ptr<int>(0);
+        vector<float> mag(I.cols), fx(I.cols), fy(I.cols);
+        vector<int> low(I.cols), bin(I.cols);
+        float *x = &fx[0], *y = &fy[0];
         for (int i=0; i<I.rows; i++)
         {
-            int oy = i/sy;
+            // angles measured from the y axis, as in fastAtan2(dx,dy)
+            const float *gx = s2.ptr<float>(i);
+            const float *gy = s1.ptr<float>(i);
             for (int j=0; j<I.cols; j++)
             {
-                int ox = j/sx;
-                int off = nbins*(oy*grid + ox);
-                int g = (int)s3.at<float>(i,j);
-                int m = (int)s4.at<float>(i,j);
-                features.at<float>(off + g + m*nsec) ++;
+                mag[j] = gx[j]*gx[j] + gy[j]*gy[j];
+                low[j] = (gy[j] < 0) | ((gy[j] == 0) & (gx[j] < 0));
+                x[j] = low[j] ? -gx[j] : gx[j];
+                y[j] = low[j] ? -gy[j] : gy[j];
+                bin[j] = 0;
+            }
+            for (size_t k=0; k<bc.size(); k++)
+            {
+                float c = bc[k], s = bs[k];
+                int ge = bge[k];
+                if (bup[k])
+                    for (int j=0; j<I.cols; j++)
+                    {
+                        float d = c*y[j] - s*x[j];
+                        bin[j] += low[j] & ((d > 0) | ((d == 0) & ge));
+                    }
+                else
+                    for (int j=0; j<I.cols; j++)
+                    {
+                        float d = c*y[j] - s*x[j];
+                        bin[j] += low[j] | ((d > 0) | ((d == 0) & ge));
+                    }
+            }
+            for (size_t k=0; k<ring.size(); k++)
+            {
+                float r = ring[k];
+                for (int j=0; j<I.cols; j++)
+                    bin[j] += nsec * (mag[j] >= r);
             }
+            int *row = cnt + nbins * grid * std::min(i/sy, grid-1);
+            for (int j=0; j<I.cols; j++)
+                row[cell[j] + (mag[j] > 0 ? bin[j] : 0)] ++;
         }
+        counts.convertTo(features, CV_32F);
         return features.total() * features.elemSize();
     }
 };
 
 
+//
+// the 4 gabor filters used by ExtractorGaborGradBin and ExtractorGabor.
+// kernels are built once, and also kept as dft spectra for the expected image size,
+// so filtering is a single forward dft of the border-padded image,
+// plus a spectrum multiply and an inverse dft per filter
+// (the same correlation filter2D does, with BORDER_REFLECT_101).
+// other image sizes fall back to filter2D with the cached kernels.
+//
+struct GaborBank
+{
+    enum { N=4 };
+    Mat kernel[N], spec[N];
+    Size isize, psize, dsize;
+    Point anchor;
+
+    GaborBank(Size ksize, Size isize=Size(90,90))
+        : isize(isize)
+    {
+        static const double param[N][5] = { // sigma, theta, lambda, gamma, psi
+            {8,4,90,15,0}, {8,4,45,30,1}, {8,4,45,45,0}, {8,4,90,60,1}
+        };
+        for (int i=0; i<N; i++)
+        {
+            const double *p = param[i];
+            getGaborKernel(ksize, p[0], p[1], p[2], p[3], p[4], CV_64F).convertTo(kernel[i], CV_32F);
+        }
+        anchor = Point(kernel[0].cols/2, kernel[0].rows/2);
+        psize = Size(isize.width + kernel[0].cols - 1, isize.height + kernel[0].rows - 1);
+        dsize = Size(getOptimalDFTSize(psize.width), getOptimalDFTSize(psize.height));
+        for (int i=0; i<N; i++)
+        {
+            // kernel anchor wrapped to the origin
+            Mat k(dsize, CV_32F, Scalar(0));
+            for (int r=0; r<kernel[i].rows; r++)
+            {
+                int y = (r - anchor.y + dsize.height) % dsize.height;
+                for (int c=0; c<kernel[i].cols; c++)
+                {
+                    int x = (c - anchor.x + dsize.width) % dsize.width;
+                    k.at<float>(y, x) = kernel[i].at<float>(r, c);
+                }
+            }
+            dft(k, spec[i]);
+        }
+    }
+
+    void filter(const Mat &src_f, Mat dest[N]) const
+    {
+        if (src_f.size() != isize)
+        {
+            for (int i=0; i<N; i++)
+                filter2D(src_f, dest[i], CV_32F, kernel[i]);
+            return;
+        }
+        Mat pad(dsize, CV_32F, Scalar(0)), fpad;
+        Mat roi = pad(Rect(Point(0,0), psize));
+        copyMakeBorder(src_f, roi, anchor.y, psize.height-isize.height-anchor.y,
+                                   anchor.x, psize.width-isize.width-anchor.x, BORDER_REFLECT_101);
+        dft(pad, fpad, 0, psize.height);
+        for (int i=0; i<N; i++)
+        {
+            Mat prod, res;
+            mulSpectrums(fpad, spec[i], prod, 0, true);
+            idft(prod, res, DFT_SCALE | DFT_REAL_OUTPUT, anchor.y + isize.height);
+            dest[i] = res(Rect(anchor, isize));
+        }
+    }
+};
+
+
 struct ExtractorGaborGradBin : public ExtractorGradBin
 {
-    Size kernel_size;
+    GaborBank bank;
 
     ExtractorGaborGradBin(int nsec=8, int nrad=2, int grid=12, int kernel_siz=9)
         : ExtractorGradBin(nsec, nrad, grid)
-        , kernel_size(kernel_siz, kernel_siz)
+        , bank(Size(kernel_siz, kernel_siz))
     {}
 
-    void gabor(const Mat &src_f, Mat &features,double sigma, double theta, double lambda, double gamma, double psi) const
-    {
-        Mat dest,dest8u,his;
-        cv::filter2D(src_f, dest, CV_32F, getGaborKernel(kernel_size, sigma,theta, lambda, gamma, psi, CV_64F));
-        //dest.convertTo(dest8u, CV_8U);
-        ExtractorGradBin::extract(dest, his);
-        features.push_back(his.reshape(1, 1));
-    }
-
     virtual int extract(const Mat &img, Mat &features) const
     {
-        Mat src_f;
+        Mat src_f, dest[GaborBank::N];
         img.convertTo(src_f, CV_32F, 1.0/255.0);
-        gabor(src_f, features, 8,4,90,15,0);
-        gabor(src_f, features, 8,4,45,30,1);
-        gabor(src_f, features, 8,4,45,45,0);
-        gabor(src_f, features, 8,4,90,60,1);
+        bank.filter(src_f, dest);
+        for (int i=0; i<GaborBank::N; i++)
+        {
+            Mat his;
+            ExtractorGradBin::extract(dest[i], his);
+            features.push_back(his.reshape(1, 1));
+        }
         features = features.reshape(1,1);
         return features.total() * features.elemSize();
     }
@@ -800,30 +1813,25 @@ struct ExtractorGaborGradBin : public ExtractorGradBin
 template <typename Grid>
 struct ExtractorGabor : public CombinedExtractor<Grid>
 {
-    Size kernel_size;
+    GaborBank bank;
 
     ExtractorGabor(const Grid &grid, int kernel_siz=8)
         : CombinedExtractor<Grid>(grid)
-        , kernel_size(kernel_siz, kernel_siz)
+        , bank(Size(kernel_siz, kernel_siz))
     {}
 
-    void gabor(const Mat &src_f, Mat &features,double sigma, double theta, double lambda, double gamma, double psi) const
-    {
-        Mat dest,dest8u,his;
-        cv::filter2D(src_f, dest, CV_32F, getGaborKernel(kernel_size, sigma,theta, lambda, gamma, psi));
-        dest.convertTo(dest8u, CV_8U);
-        CombinedExtractor<Grid>::extract(dest8u, his);
-        features.push_back(his.reshape(1, 1));
-    }
-
     virtual int extract(const Mat &img, Mat &features) const
     {
-        Mat src_f;
+        Mat src_f, dest[GaborBank::N];
         img.convertTo(src_f, CV_32F, 1.0/255.0);
-        gabor(src_f, features, 8,4,90,15,0);
-        gabor(src_f, features, 8,4,45,30,1);
-        gabor(src_f, features, 8,4,45,45,0);
-        gabor(src_f, features, 8,4,90,60,1);
+        bank.filter(src_f, dest);
+        for (int i=0; i<GaborBank::N; i++)
+        {
+            Mat dest8u, his;
+            dest[i].convertTo(dest8u, CV_8U);
+            CombinedExtractor<Grid>::extract(dest8u, his);
+            features.push_back(his.reshape(1, 1));
+        }
         features = features.reshape(1,1);
         return features.total() * features.elemSize();
     }
@@ -835,76 +1843,285 @@ struct ExtractorGabor : public CombinedExtractor<Grid>
 // grid it into 8x8 image patches, do a dct on each,
 //  concat downsampled 4x4(topleft) result to feature vector.
 //
+// only those 16 coefficients get computed: an even/odd butterfly per row,
+//  then the same on the 4 (horizontal) frequencies down the columns,
+//  with one sse register per block row.
+//
 struct ExtractorDct : public TextureFeature::Extractor
 {
-    int grid;
+    enum { grid=8, keep=4 };
+    float cf[keep][keep]; // 1d dct-II (orthonormal, as cv::dct) on the butterfly terms
+
+    ExtractorDct()
+    {
+        for (int k=0; k<keep; k++)
+        {
+            double c = k ? sqrt(2.0/grid) : sqrt(1.0/grid);
+            for (int n=0; n<keep; n++)
+                cf[k][n] = float(c * cos(CV_PI * (2*n+1) * k / (2*grid)));
+        }
+    }
+
+    // the 4 low frequencies of 8 values x[0],x[st],..
+    void dct_8_4(const float *x, int st, float *y) const
+    {
+        float s[keep], d[keep];
+        for (int n=0; n<keep; n++)
+        {
+            s[n] = x[n*st] + x[(grid-1-n)*st];
+            d[n] = x[n*st] - x[(grid-1-n)*st];
+        }
+        for (int k=0; k<keep; k++)
+        {
+            const float *t = (k & 1) ? d : s;
+            y[k] = cf[k][0]*t[0] + cf[k][1]*t[1] + cf[k][2]*t[2] + cf[k][3]*t[3];
+        }
+    }
 
-    ExtractorDct() : grid(8) {}
+    void block(const Mat &src, int y, int x, float *out) const
+    {
+        float t[grid][keep];
+        for (int r=0; r<grid; r++)
+            dct_8_4(src.ptr<float>(y+r) + x, 1, t[r]);
+#ifdef HAVE_SSE
+        __m128 s[keep], d[keep];
+        for (int n=0; n<keep; n++)
+        {
+            __m128 a = _mm_loadu_ps(t[n]), b = _mm_loadu_ps(t[grid-1-n]);
+            s[n] = _mm_add_ps(a, b);
+            d[n] = _mm_sub_ps(a, b);
+        }
+        for (int k=0; k<keep; k++)
+        {
+            const __m128 *v = (k & 1) ? d : s;
+            __m128 acc = _mm_mul_ps(_mm_set1_ps(cf[k][0]), v[0]);
+            for (int n=1; n<keep; n++)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(cf[k][n]), v[n]));
+            _mm_storeu_ps(out + k*keep, acc);
+        }
+#else
+        float col[keep];
+        for (int v=0; v<keep; v++)
+        {
+            dct_8_4(&t[0][v], keep, col);
+            for (int k=0; k<keep; k++)
+                out[k*keep + v] = col[k];
+        }
+#endif
+    }
 
     virtual int extract( const Mat &img, Mat &features ) const
     {
         Mat src;
         img.convertTo(src,CV_32F,1.0/255.0);
-        for(int i=0; i<src.rows-grid; i+=grid)
+        int ny = std::max(0, (src.rows-1)/grid);
+        int nx = std::max(0, (src.cols-1)/grid);
+        features.create(1, ny*nx*keep*keep, CV_32F);
+        float *out = features.ptr<float>(0);
+        // blocks column by column, as they always were listed
+        for (int x=0; x<nx*grid; x+=grid)
         {
-            for(int j=0; j<src.cols-grid; j+=grid)
+            for (int y=0; y<ny*grid; y+=grid)
             {
-                Mat d;
-                dct(src(Rect(i,j,grid,grid)),d);
-                // downsampling is just a ROI operation here, still we need a clone()
-                Mat e = d(Rect(0,0,grid/2,grid/2)).clone();
-                features.push_back(e.reshape(1,1));
+                block(src, y, x, out);
+                out += keep*keep;
             }
         }
-        features = features.reshape(1,1);
         return features.total() * features.elemSize();
     }
 };
 
 
 
+//
+// Feature2D instances are costly to create per image, and not safe to share
+// between threads, so each thread keeps its own (in a TLSData slot),
+// along with the keypoint layout for the last image size it saw,
+// and a keypoint buffer to hand to compute() (which may drop some).
+//
+template < class Descriptor >
+struct Feature2dSlot
+{
+    Ptr<Feature2D> f2d;
+    Size size;
+    vector<KeyPoint> layout, kp;
+
+    Feature2D &get()
+    {
+        if (f2d.empty())
+            f2d = Descriptor::create();
+        return *f2d;
+    }
+};
+
+
 template < class Descriptor >
 struct ExtractorGridFeature2d : public TextureFeature::Extractor
 {
     int grid;
+    TLSData< Feature2dSlot<Descriptor> > slots;
+
+    ExtractorGridFeature2d(int g=10) : grid(g) {}
+
+    virtual int extract(const Mat &img, Mat &features) const
+    {
+        Feature2dSlot<Descriptor> &slot = *slots.get();
+        if (slot.layout.empty() || slot.size != img.size())
+        {
+            float gw = float(img.cols) / grid;
+            float gh = float(img.rows) / grid;
+            slot.layout.clear();
+            for (float i=gh/2; i<img.rows-gh; i+=gh)
+            {
+                for (float j=gw/2; j<img.cols-gw; j+=gw)
+                {
+                    KeyPoint k(j, i, gh);
+                    slot.layout.push_back(k);
+                }
+            }
+            slot.size = img.size();
+        }
+        slot.kp.assign(slot.layout.begin(), slot.layout.end());
+        slot.get().compute(img, slot.kp, features);
+
+        features = features.reshape(1,1);
+        return features.total() * features.elemSize();
+    }
+};
+typedef ExtractorGridFeature2d<ORB> ExtractorORBGrid;
+typedef ExtractorGridFeature2d<BRISK> ExtractorBRISKGrid;
+typedef ExtractorGridFeature2d<xfeatures2d::FREAK> ExtractorFREAKGrid;
+typedef ExtractorGridFeature2d<xfeatures2d::SIFT> ExtractorSIFTGrid;
+typedef ExtractorGridFeature2d<xfeatures2d::BriefDescriptorExtractor> ExtractorBRIEFGrid;
+
+
+//
+// dense sift on the same grid as ExtractorSIFTGrid, vlfeat's dsift style:
+//  the gradient gets split into 8 orientation planes once,
+//  a triangular filter (one bin wide) on each plane does the spatial binning
+//  for all keypoints at once, so each of the 4x4 bins is just a lookup.
+//  everything else follows opencv's sift descriptor for upright keypoints
+//  at octave 0 (base blur 1.6, 3*size/2 pixels per bin, gaussian window,
+//  clamped at 0.2, scaled to [0..255]), except that the window is taken
+//  at the bin centers, not per pixel ('flat window').
+//
+struct ExtractorDenseSift : public TextureFeature::Extractor
+{
+    enum { D=4, N=8 };
+    int grid;
+
+    ExtractorDenseSift(int g=10) : grid(g) {}
 
-    ExtractorGridFeature2d(int g=10) : grid(g) {}
+    static float sample(const Mat &m, float x, float y)
+    {
+        int x0 = cvFloor(x), y0 = cvFloor(y);
+        float fx = x - x0, fy = y - y0, v = 0;
+        for (int r=0; r<2; r++)
+        {
+            if (y0+r < 0 || y0+r >= m.rows) continue;
+            const float *p = m.ptr<float>(y0+r);
+            float wy = r ? fy : 1-fy;
+            if (x0 >= 0 && x0 < m.cols)     v += wy * (1-fx) * p[x0];
+            if (x0+1 >= 0 && x0+1 < m.cols) v += wy * fx * p[x0+1];
+        }
+        return v;
+    }
 
     virtual int extract(const Mat &img, Mat &features) const
     {
         float gw = float(img.cols) / grid;
         float gh = float(img.rows) / grid;
-        vector<KeyPoint> kp;
+        float bin = 3 * gh * 0.5f;
+
+        Mat I;
+        img.convertTo(I, CV_32F);
+        GaussianBlur(I, I, Size(), sqrt(1.6*1.6 - 0.5*0.5));
+
+        // orientation planes, magnitude split between the 2 nearest orientations
+        Mat plane[N];
+        for (int o=0; o<N; o++)
+            plane[o] = Mat(I.size(), CV_32F, Scalar(0));
+        for (int r=1; r<I.rows-1; r++)
+        {
+            const float *up = I.ptr<float>(r-1), *mid = I.ptr<float>(r), *dn = I.ptr<float>(r+1);
+            float *p[N];
+            for (int o=0; o<N; o++)
+                p[o] = plane[o].ptr<float>(r);
+            for (int c=1; c<I.cols-1; c++)
+            {
+                float dx = mid[c+1] - mid[c-1];
+                float dy = up[c] - dn[c];
+                float mag = sqrt(dx*dx + dy*dy);
+                float a = fastAtan2(dy, dx) * N / 360.f;
+                int o0 = cvFloor(a);
+                a -= o0;
+                o0 &= N-1;
+                p[o0] [c] += mag * (1-a);
+                p[(o0+1) & (N-1)] [c] += mag * a;
+            }
+        }
+
+        // spatial binning
+        int kr = cvFloor(bin);
+        Mat_<float> tri(1, 2*kr+1);
+        for (int t=-kr; t<=kr; t++)
+            tri(0, t+kr) = 1 - std::abs(t)/bin;
+        for (int o=0; o<N; o++)
+            sepFilter2D(plane[o], plane[o], CV_32F, tri, tri, Point(-1,-1), 0, BORDER_CONSTANT);
+
+        float win[D]; // bin centers, in bins from the keypoint
+        for (int b=0; b<D; b++)
+            win[b] = b - D*0.5f + 0.5f;
+
+        int nkp = 0;
+        for (float i=gh/2; i<img.rows-gh; i+=gh)
+            for (float j=gw/2; j<img.cols-gw; j+=gw)
+                nkp++;
+        features.create(1, nkp*D*D*N, CV_32F);
+        float *dst = features.ptr<float>(0);
         for (float i=gh/2; i<img.rows-gh; i+=gh)
         {
             for (float j=gw/2; j<img.cols-gw; j+=gw)
             {
-                KeyPoint k(j, i, gh);
-                kp.push_back(k);
+                int x = cvRound(j), y = cvRound(i);
+                float nrm = 0;
+                for (int by=0; by<D; by++)
+                {
+                    for (int bx=0; bx<D; bx++)
+                    {
+                        float w = exp(-(win[bx]*win[bx] + win[by]*win[by]) / (D*D*0.5f));
+                        for (int o=0; o<N; o++)
+                        {
+                            float v = w * sample(plane[o], x + win[bx]*bin, y + win[by]*bin);
+                            dst[(by*D + bx)*N + o] = v;
+                            nrm += v*v;
+                        }
+                    }
+                }
+                // as in sift: clamp large values at 0.2 of the norm, renormalize
+                float thr = sqrt(nrm) * 0.2f;
+                nrm = 0;
+                for (int k=0; k<D*D*N; k++)
+                {
+                    dst[k] = std::min(dst[k], thr);
+                    nrm += dst[k]*dst[k];
+                }
+                nrm = nrm > 0 ? 512.f / sqrt(nrm) : 0;
+                for (int k=0; k<D*D*N; k++)
+                    dst[k] = saturate_cast<uchar>(dst[k]*nrm);
+                dst += D*D*N;
             }
         }
-        Ptr<Feature2D> f2d = Descriptor::create();
-        f2d->compute(img, kp, features);
-
-        features = features.reshape(1,1);
         return features.total() * features.elemSize();
     }
 };
-typedef ExtractorGridFeature2d<ORB> ExtractorORBGrid;
-typedef ExtractorGridFeature2d<BRISK> ExtractorBRISKGrid;
-typedef ExtractorGridFeature2d<xfeatures2d::FREAK> ExtractorFREAKGrid;
-typedef ExtractorGridFeature2d<xfeatures2d::SIFT> ExtractorSIFTGrid;
-typedef ExtractorGridFeature2d<xfeatures2d::BriefDescriptorExtractor> ExtractorBRIEFGrid;
 
+
+template < class Descriptor >
 struct ExtractorGfttFeature2d : public TextureFeature::Extractor
 {
-    Ptr<Feature2D> f2d;
     LandMarks land;
-
-    ExtractorGfttFeature2d(Ptr<Feature2D> f)
-        : f2d(f)
-    {
-    }
+    TLSData< Feature2dSlot<Descriptor> > slots;
 
     virtual int extract(const Mat &img, Mat &features) const
     {
@@ -913,29 +2130,40 @@ struct ExtractorGfttFeature2d : public TextureFeature::Extractor
         vector<Point> pt;
         land.extract(img,pt);
 
-        size_t s = pt.size();
-        float w=5;
-        vector<KeyPoint> kp;
+        // 5 keypoints per landmark, the center and its 4 neighbours
+        Feature2dSlot<Descriptor> &slot = *slots.get();
+        if (slot.layout.empty())
+        {
+            float w=5;
+            slot.layout.push_back(KeyPoint(0,0,w*2,8));
+            slot.layout.push_back(KeyPoint(0,-w,w*2,8));
+            slot.layout.push_back(KeyPoint(0,w,w*2,8));
+            slot.layout.push_back(KeyPoint(-w,0,w*2,8));
+            slot.layout.push_back(KeyPoint(w,0,w*2,8));
+            //slot.layout.push_back(KeyPoint(-w,-w/2,w*2));
+            //slot.layout.push_back(KeyPoint(-w,w/2,w*2));
+            //slot.layout.push_back(KeyPoint(w,-w/2,w*2));
+            //slot.layout.push_back(KeyPoint(w,w/2,w*2));
+        }
+        size_t s = pt.size(), n = slot.layout.size();
+        slot.kp.resize(s*n);
         for (size_t i=0; i<s; i++)
         {
             Point2f p(pt[i]);
-            kp.push_back(KeyPoint(p.x,p.y,w*2,8));
-            kp.push_back(KeyPoint(p.x,p.y-w,w*2,8));
-            kp.push_back(KeyPoint(p.x,p.y+w,w*2,8));
-            kp.push_back(KeyPoint(p.x-w,p.y,w*2,8));
-            kp.push_back(KeyPoint(p.x+w,p.y,w*2,8));
-            //kp.push_back(KeyPoint(p.x-w,p.y-w/2,w*2));
-            //kp.push_back(KeyPoint(p.x-w,p.y+w/2,w*2));
-            //kp.push_back(KeyPoint(p.x+w,p.y-w/2,w*2));
-            //kp.push_back(KeyPoint(p.x+w,p.y+w/2,w*2));
+            for (size_t j=0; j<n; j++)
+            {
+                KeyPoint &k = slot.kp[i*n+j];
+                k = slot.layout[j];
+                k.pt += p;
+            }
         }
-        f2d->compute(img, kp, features);
+        slot.get().compute(img, slot.kp, features);
         //Mat f2;
         //for (size_t i=0; i< features.rows; i++)
         //{
         //    Mat f = features.row(i)(Rect(32,0,64,1)).clone().reshape(1,64);
-        //    f.push_back(kp[i].pt.x / img.cols - 0.5f);
-        //    f.push_back(kp[i].pt.y / img.rows - 0.5f);
+        //    f.push_back(slot.kp[i].pt.x / img.cols - 0.5f);
+        //    f.push_back(slot.kp[i].pt.y / img.rows - 0.5f);
         //    f2.push_back(f);
         //}
         // resize(features,features,Size(),0.5,1.0);                  // not good.
@@ -945,6 +2173,7 @@ struct ExtractorGfttFeature2d : public TextureFeature::Extractor
         return features.total() * features.elemSize();
     }
 };
+typedef ExtractorGfttFeature2d<xfeatures2d::SIFT> ExtractorSIFTGftt;
 
 
 
@@ -953,48 +2182,244 @@ struct ExtractorGfttFeature2d : public TextureFeature::Extractor
 //    and Its Application to Face Recognition"
 //    Bor-Chun Chen, Chu-Song Chen, Winston Hsu
 //
+static const float hdlbp_scale[] = {0.75f, 1.06f, 1.5f, 2.2f, 3.0f}; // http://bcsiriuschen.github.io/High-Dimensional-LBP/
+static const int hdlbp_nscales = 5;
+static const float hdlbp_offsets_16[] = {
+    -1.5f,-1.5f, -0.5f,-1.5f, 0.5f,-1.5f, 1.5f,-1.5f,
+    -1.5f,-0.5f, -0.5f,-0.5f, 0.5f,-0.5f, 1.5f,-0.5f,
+    -1.5f, 0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 1.5f, 0.5f,
+    -1.5f, 1.5f, -0.5f, 1.5f, 0.5f, 1.5f, 1.5f, 1.5f
+};
+static const int hdlbp_noff = 16;
+
+//
+// the fplbp code image per scale
+//
+struct HDLbpScales : public ParallelLoopBody
+{
+    const FeatureFPLbp &lbp;
+    const Mat &img;
+    Mat *f;
+
+    HDLbpScales(const FeatureFPLbp &lbp, const Mat &img, Mat *f)
+        : lbp(lbp), img(img), f(f)
+    {}
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i=range.start; i<range.end; i++)
+        {
+            float s = hdlbp_scale[i];
+            Mat imgs;
+            resize(img,imgs,Size(),s,s);
+            lbp(imgs,f[i]);
+        }
+    }
+};
+
+//
+// the 16 patch histograms around one landmark on one scale,
+//   one task per (scale,landmark) pair.
+//   each one owns the slice at histo + i*si + k*sk, so the outcome
+//   does not depend on the thread schedule.
+//
+//   interp: bilinear patches from getRectSubPix (as in the paper's code),
+//   else the patch origin is rounded to the pixel grid, and the codes
+//   are counted in place (no interpolated, copied patch).
+//
+struct HDLbpPatches : public ParallelLoopBody
+{
+    const Mat *f;
+    const vector<Point> &kp;
+    float *histo;
+    int si, sk, histSize;
+    bool interp;
+
+    HDLbpPatches(const Mat *f, const vector<Point> &kp, float *histo, int si, int sk, int histSize, bool interp)
+        : f(f), kp(kp), histo(histo), si(si), sk(sk), histSize(histSize), interp(interp)
+    {}
+
+    virtual void operator()(const Range &range) const
+    {
+        int gr=10; // 10 used in paper
+        const float *off = hdlbp_offsets_16;
+        for (int t=range.start; t<range.end; t++)
+        {
+            int i = t / int(kp.size());
+            int k = t % int(kp.size());
+            float s = hdlbp_scale[i];
+            Point2f pt(kp[k]);
+            float *h = histo + i*si + k*sk;
+            Rect bounds(Point(), f[i].size());
+            for (int o=0; o<hdlbp_noff; o++)
+            {
+                Point2f c(pt.x*s + off[o*2]*gr, pt.y*s + off[o*2+1]*gr);
+                if (interp)
+                {
+                    Mat patch;
+                    getRectSubPix(f[i], Size(gr,gr), c, patch);
+                    hist_patch(patch, h + o*histSize, histSize);
+                }
+                else
+                {
+                    Rect part(cvRound(c.x - (gr-1)*0.5f), cvRound(c.y - (gr-1)*0.5f), gr, gr);
+                    hist_patch(f[i](part & bounds), h + o*histSize, histSize);
+                }
+            }
+        }
+    }
+};
+
+//
+// the scale planes are computed once per ImageScope
+//
+static void hdlbp_scales(const FeatureFPLbp &lbp, const Mat &img, Mat *f)
+{
+    ImageShared *s = shared_for(img);
+    if (!s)
+    {
+        parallel_for_(Range(0, hdlbp_nscales), HDLbpScales(lbp, img, f));
+        return;
+    }
+    Mat *plane[hdlbp_nscales];
+    for (int i=0; i<hdlbp_nscales; i++)
+        plane[i] = &s->planes[format("hdlbp/%d/%d", lbp.radius, i)];
+    if (plane[0]->empty())
+    {
+        parallel_for_(Range(0, hdlbp_nscales), HDLbpScales(lbp, img, f));
+        for (int i=0; i<hdlbp_nscales; i++)
+            *plane[i] = f[i];
+        return;
+    }
+    for (int i=0; i<hdlbp_nscales; i++)
+        f[i] = *plane[i];
+}
+
+static void hdlbp_hist(const FeatureFPLbp &lbp, const Mat &img, const vector<Point> &kp, float *histo, int si, int sk, bool interp=true)
+{
+    Mat f[hdlbp_nscales];
+    hdlbp_scales(lbp, img, f);
+    parallel_for_(Range(0, hdlbp_nscales*int(kp.size())), HDLbpPatches(f, kp, histo, si, sk, lbp.bins(), interp));
+}
+
+
 struct HighDimLbp : public TextureFeature::Extractor
 {
     FeatureFPLbp lbp;
     LandMarks land;
+    bool interp;
+
+    HighDimLbp(bool interp=true) : interp(interp) {}
 
     virtual int extract(const Mat &img, Mat &features) const
     {
         //PROFILEX("extract");
-        int gr=10; // 10 used in paper
         vector<Point> kp;
         land.extract(img,kp);
 
-        Mat histo;
-        float scale[] = {0.75f, 1.06f, 1.5f, 2.2f, 3.0f}; // http://bcsiriuschen.github.io/High-Dimensional-LBP/
-        float offsets_16[] = {
-            -1.5f,-1.5f, -0.5f,-1.5f, 0.5f,-1.5f, 1.5f,-1.5f,
-            -1.5f,-0.5f, -0.5f,-0.5f, 0.5f,-0.5f, 1.5f,-0.5f,
-            -1.5f, 0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 1.5f, 0.5f,
-            -1.5f, 1.5f, -0.5f, 1.5f, 0.5f, 1.5f, 1.5f, 1.5f
-        };
-        int noff = 16;
-        float *off = offsets_16;
-        for (int i=0; i<5; i++)
+        // scale major: [scale][landmark][offset][bin]
+        int sk = hdlbp_noff*lbp.bins();
+        int si = int(kp.size())*sk;
+        Mat_<float> histo(1, hdlbp_nscales*si);
+        hdlbp_hist(lbp, img, kp, histo[0], si, sk, interp);
+
+        normalize(histo, features);
+        return features.total() * features.elemSize();
+    }
+};
+
+//
+// the 20 per-landmark pca's, stacked: the eigenvectors of landmark k are rows
+// off[k]..off[k+1] of one contiguous float block, its mean is row k of another.
+// projecting a landmark is a gemm on a row range, for a single image,
+// or for a whole stack of images at once.
+//
+struct PcaBank
+{
+    enum { N=20 };
+    Mat_<float> eig, mean;
+    int off[N+1];
+
+    void read(const FileNode &pnodes)
+    {
+        PCA pca[N];
+        int n=0;
+        for (FileNodeIterator it=pnodes.begin(); it!=pnodes.end() && n<N; ++it)
         {
-            float s = scale[i];
-            Mat f1,f2,imgs;
-            resize(img,imgs,Size(),s,s);
-            int histSize = lbp(imgs,f1);
+            pca[n++].read(*it);
+        }
+        CV_Assert(n == N);
+        int dims = pca[0].eigenvectors.cols;
+        off[0] = 0;
+        for (int k=0; k<N; k++)
+        {
+            CV_Assert(pca[k].eigenvectors.cols == dims && int(pca[k].mean.total()) == dims);
+            off[k+1] = off[k] + pca[k].eigenvectors.rows;
+        }
+        eig = Mat_<float>(off[N], dims);
+        mean = Mat_<float>(N, dims);
+        for (int k=0; k<N; k++)
+        {
+            Mat e = eig.rowRange(off[k], off[k+1]);
+            pca[k].eigenvectors.convertTo(e, CV_32F);
+            Mat m = mean.row(k);
+            pca[k].mean.reshape(1,1).convertTo(m, CV_32F);
+        }
+    }
+
+    void load(const String &file, const String &node)
+    {
+        FileStorage fs(file, FileStorage::READ);
+        CV_Assert(fs.isOpened());
+        read(fs[node]);
+        fs.release();
+    }
+
+    int size() const { return off[N]; }
+
+    // x: one sample per row, centered in place; y: the projections, one row each
+    void project(int k, Mat &x, Mat &y) const
+    {
+        const float *m = mean.ptr<float>(k);
+        for (int r=0; r<x.rows; r++)
+        {
+            float *p = x.ptr<float>(r);
+            for (int c=0; c<x.cols; c++)
+                p[c] -= m[c];
+        }
+        gemm(x, eig.rowRange(off[k], off[k+1]), 1, Mat(), 0, y, GEMM_2_T);
+    }
+};
+
+
+//
+// normalize the landmark histograms, and project them with their landmark's pca.
+// h holds n rows per landmark (landmark major), histo gets n rows of projections.
+//
+struct HDLbpProject : public ParallelLoopBody
+{
+    const PcaBank &bank;
+    const Mat &h;
+    int n;
+    Mat &histo;
+
+    HDLbpProject(const PcaBank &bank, const Mat &h, int n, Mat &histo)
+        : bank(bank), h(h), n(n), histo(histo)
+    {}
 
-            for (size_t k=0; k<kp.size(); k++)
+    virtual void operator()(const Range &range) const
+    {
+        for (int k=range.start; k<range.end; k++)
+        {
+            Mat x = h.rowRange(k*n, (k+1)*n);
+            for (int r=0; r<n; r++)
             {
-                Point2f pt(kp[k]);
-                for (int o=0; o<noff; o++)
-                {
-                    Mat patch;
-                    getRectSubPix(f1, Size(gr,gr), Point2f(pt.x*s + off[o*2]*gr, pt.y*s + off[o*2+1]*gr), patch);
-                    hist_patch(patch, histo, histSize);
-                }
+                Mat hx = x.row(r);
+                normalize(hx,hx);
             }
+            Mat y = histo.colRange(bank.off[k], bank.off[k+1]);
+            bank.project(k, x, y);
         }
-        normalize(histo.reshape(1,1), features);
-        return features.total() * features.elemSize();
     }
 };
 
@@ -1003,19 +2428,11 @@ struct HighDimLbpPCA : public TextureFeature::Extractor
     LandMarks land;
     FeatureFPLbp lbp;
     //FeatureLbp lbp;
-    PCA pca[20];
+    Ptr<PcaBank> bank;
 
     HighDimLbpPCA()
     {
-        FileStorage fs("data/fplbp_pca.xml.gz",FileStorage::READ);
-        CV_Assert(fs.isOpened());
-        FileNode pnodes = fs["hdlbp"];
-        int i=0;
-        for (FileNodeIterator it=pnodes.begin(); it!=pnodes.end(); ++it)
-        {
-            pca[i++].read(*it);
-        }
-        fs.release();
+        bank = shared_asset<PcaBank>("data/fplbp_pca.xml.gz", "hdlbp");
 
         //FILE * f = fopen("data/pca.hdlbpu.bin","rb");
         //CV_Assert(f!=0);
@@ -1042,49 +2459,56 @@ struct HighDimLbpPCA : public TextureFeature::Extractor
     virtual int extract(const Mat &img, Mat &features) const
     {
         //PROFILEX("extract");
-        int gr=10; // 10 used in paper
         vector<Point> kp;
         land.extract(img,kp);
         CV_Assert(kp.size()==20);
-        Mat histo;
-        float scale[] = {0.75f, 1.06f, 1.5f, 2.2f, 3.0f}; // http://bcsiriuschen.github.io/High-Dimensional-LBP/
-        float offsets_16[] = {
-            -1.5f,-1.5f, -0.5f,-1.5f, 0.5f,-1.5f, 1.5f,-1.5f,
-            -1.5f,-0.5f, -0.5f,-0.5f, 0.5f,-0.5f, 1.5f,-0.5f,
-            -1.5f, 0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 1.5f, 0.5f,
-            -1.5f, 1.5f, -0.5f, 1.5f, 0.5f, 1.5f, 1.5f, 1.5f
-        };
-        int noff = 16;
-        float *off = offsets_16;
-        Mat h[20];
-        for (int i=0; i<5; i++)
-        {
-            float s = scale[i];
-            Mat f1,f2,imgs;
-            resize(img,imgs,Size(),s,s);
-            int histSize = lbp(imgs,f1);
 
-            for (size_t k=0; k<kp.size(); k++)
+        // landmark major, one row per landmark: [scale][offset][bin]
+        int si = hdlbp_noff*lbp.bins();
+        Mat_<float> h(20, hdlbp_nscales*si);
+        hdlbp_hist(lbp, img, kp, h[0], si, h.cols);
+
+        Mat_<float> histo(1, bank->size());
+        parallel_for_(Range(0,20), HDLbpProject(*bank, h, 1, histo));
+
+        normalize(histo, features);
+        return features.total() * features.elemSize();
+    }
+
+    //
+    // histograms for a chunk of images get stacked per landmark,
+    // so each landmark is projected with a single (images x dims) gemm.
+    //
+    virtual int extractBatch(const std::vector<Mat> &images, Mat &features) const
+    {
+        features.release();
+        int nimg = int(images.size());
+        if (nimg == 0)
+            return 0;
+
+        const int chunk = 64; // 20 histograms of 5 KB per image
+        int si = hdlbp_noff*lbp.bins();
+        features.create(nimg, bank->size(), CV_32F);
+        for (int i=0; i<nimg; i+=chunk)
+        {
+            int n = std::min(chunk, nimg-i);
+            Mat_<float> h(20*n, hdlbp_nscales*si);
+            for (int j=0; j<n; j++)
             {
-                Point2f pt(kp[k]);
-                for (int o=0; o<noff; o++)
-                {
-                    Mat patch;
-                    getRectSubPix(f1, Size(gr,gr), Point2f(pt.x*s + off[o*2]*gr, pt.y*s + off[o*2+1]*gr), patch);
-                    hist_patch(patch, h[k], histSize);
-                    //hist_patch_uniform(patch, h[k], histSize);
-                }
+                vector<Point> kp;
+                land.extract(images[i+j], kp);
+                CV_Assert(kp.size()==20);
+                hdlbp_hist(lbp, images[i+j], kp, h[j], si, n*h.cols);
             }
+            Mat histo = features.rowRange(i, i+n);
+            parallel_for_(Range(0,20), HDLbpProject(*bank, h, n, histo));
         }
-        for (size_t k=0; k<kp.size(); k++)
+        for (int i=0; i<nimg; i++)
         {
-            Mat hx = h[k].reshape(1,1);
-            normalize(hx,hx);
-            Mat hy = pca[k].project(hx);
-            histo.push_back(hy);
+            Mat r = features.row(i);
+            normalize(r, r);
         }
-        normalize(histo.reshape(1,1), features);
-        return features.total() * features.elemSize();
+        return features.cols * features.elemSize();
     }
 };
 
@@ -1092,22 +2516,20 @@ struct HighDimLbpPCA : public TextureFeature::Extractor
 struct HighDimPCASift : public TextureFeature::Extractor
 {
     LandMarks land;
-    Ptr<Feature2D> sift;
-    PCA pca[20];
+    TLSData< Feature2dSlot<xfeatures2d::SIFT> > slots;
+    Ptr<PcaBank> bank;
 
     HighDimPCASift()
-        : sift(xfeatures2d::SIFT::create())
     {
-        FileStorage fs("data/hd_pcasift_20.xml.gz",FileStorage::READ);
-        CV_Assert(fs.isOpened());
-        FileNode pnodes = fs["hd_pcasift"];
-        int i=0;
-        for (FileNodeIterator it=pnodes.begin(); it!=pnodes.end(); ++it)
-        {
-            pca[i++].read(*it);
-        }
-        fs.release();
+        bank = shared_asset<PcaBank>("data/hd_pcasift_20.xml.gz", "hd_pcasift");
     }
+
+    //
+    // all 20x16 keypoints go through a single sift compute().
+    // the stacked descriptors (+ position) are projected block by block,
+    // one gemm per landmark, straight into the feature row
+    // (the same (x-mean)*eigenvectors' PCA::project does per descriptor).
+    //
     virtual int extract(const Mat &img, Mat &features) const
     {
         int gr=5; // 10 used in paper
@@ -1115,47 +2537,36 @@ struct HighDimPCASift : public TextureFeature::Extractor
         land.extract(img,pt);
         CV_Assert(pt.size()==20);
 
-        Mat histo;
-        float scale[] = {0.75f, 1.06f, 1.5f, 2.2f, 3.0f}; // http://bcsiriuschen.github.io/High-Dimensional-LBP/
-        float offsets_16[] = {
-            -1.5f,-1.5f, -0.5f,-1.5f, 0.5f,-1.5f, 1.5f,-1.5f,
-            -1.5f,-0.5f, -0.5f,-0.5f, 0.5f,-0.5f, 1.5f,-0.5f,
-            -1.5f, 0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 1.5f, 0.5f,
-            -1.5f, 1.5f, -0.5f, 1.5f, 0.5f, 1.5f, 1.5f, 1.5f
-        };
-        float offsets_9[] = {
-            -1.f,-1.f, 0.f,-1.f, 1.f,-1.f,
-            -1.f, 0.f, 0.f, 0.f, 1.f, 0.f,
-            -1.f, 1.f, 0.f, 1.f, 1.f, 1.f,
-        };
-        int noff = 16;
-        float *off = offsets_16;
-//        for (int i=0; i<5; i++)
+        Feature2dSlot<xfeatures2d::SIFT> &slot = *slots.get();
+        slot.kp.clear();
+        for (size_t k=0; k<pt.size(); k++)
         {
-            float s = 1.0f;//scale[i];
-            Mat f1,f2,imgs;
-            resize(img,imgs,Size(),s,s);
-
-            for (size_t k=0; k<pt.size(); k++)
+            for (int o=0; o<hdlbp_noff; o++)
             {
-                vector<KeyPoint> kp;
-                Mat h;
-                for (int o=0; o<noff; o++)
-                {
-                    kp.push_back(KeyPoint(pt[k].x*s + off[o*2]*gr, pt[k].y*s + off[o*2+1]*gr,gr));
-                }
-                sift->compute(imgs,kp,h);
-                for (size_t j=0; j<kp.size(); j++)
-                {
-                    Mat hx = h.row(j).t();
-                    hx.push_back(float(kp[j].pt.x/img.cols - 0.5));
-                    hx.push_back(float(kp[j].pt.y/img.rows - 0.5));
-                    Mat hy = pca[k].project(hx.reshape(1,1));
-                    histo.push_back(hy);
-                }
+                slot.kp.push_back(KeyPoint(pt[k].x + hdlbp_offsets_16[o*2]*gr, pt[k].y + hdlbp_offsets_16[o*2+1]*gr, gr));
             }
         }
-        features = histo.reshape(1,1);
+        Mat desc;
+        slot.get().compute(img, slot.kp, desc);
+        CV_Assert(desc.rows == int(slot.kp.size()) && desc.type() == CV_32F);
+
+        int nd = desc.cols;
+        Mat data(desc.rows, nd+2, CV_32F);
+        CV_Assert(bank->mean.cols == nd+2);
+        for (int j=0; j<desc.rows; j++)
+        {
+            float *r = data.ptr<float>(j);
+            memcpy(r, desc.ptr<float>(j), nd*sizeof(float));
+            r[nd]   = float(slot.kp[j].pt.x/img.cols - 0.5);
+            r[nd+1] = float(slot.kp[j].pt.y/img.rows - 0.5);
+        }
+        features.create(1, hdlbp_noff * bank->size(), CV_32F);
+        for (int k=0; k<20; k++)
+        {
+            Mat x = data.rowRange(k*hdlbp_noff, (k+1)*hdlbp_noff);
+            Mat proj(hdlbp_noff, bank->off[k+1]-bank->off[k], CV_32F, features.ptr<float>(0) + hdlbp_noff*bank->off[k]);
+            bank->project(k, x, proj);
+        }
         return features.total() * features.elemSize();
     }
 };
@@ -1219,88 +2630,254 @@ struct ExtractorCDIKP : public TextureFeature::Extractor
 {
     LandMarks land;
 
-    template<class T>
-    void fast_had(int ndim, int lev, T *in, T *out) const
+    enum { ps=16, step=3, keep=10 };
+
+    //
+    // the 10 coefficients kept from the (7 stage) walsh-hadamard transform
+    // of a 16x16 patch only depend on the column sums of the patch:
+    // coefficient 2s+p sums the columns of parity p, signed by the
+    // hadamard row s over the column's upper 3 bits.
+    // the patches are sampled at half-pixel centers (getRectSubPix),
+    // so a column sum is the mean of 4 column runs of the gradient image,
+    // read from its column-wise running sums.
+    //
+    static void colsums(const Mat &grad, Mat_<float> &cum)
     {
-        int h = lev/2;
-        for (int j=0; j<ndim/lev; j++)
+        Mat pad;
+        copyMakeBorder(grad, pad, ps/2, ps/2+1, ps/2, ps/2+1, BORDER_REPLICATE);
+        cum = Mat_<float>(pad.rows+1, pad.cols, 0.0f);
+        for (int r=0; r<pad.rows; r++)
         {
-            for(int i=0; i<h; i++)
-            {
-                out[i]   = in[i] + in[i+h];
-                out[i+h] = in[i] - in[i+h];
-            }
-            out += lev;
-            in  += lev;
+            const float *g = pad.ptr<float>(r);
+            const float *c = cum.ptr<float>(r);
+            float *d = cum.ptr<float>(r+1);
+            for (int x=0; x<pad.cols; x++)
+                d[x] = c[x] + g[x];
         }
     }
-    Mat project(Mat &in) const
+
+    static void project(const Mat_<float> &cum, int y, int x, float *out)
     {
-        const int keep = 10;
-        Mat h = in.clone().reshape(1,1);
-        Mat wh(1, h.total(), h.type());
-        for (int lev=in.total(); lev>2; lev/=2)
+        // y,x: top-left pixel of the window, in padded coords
+        const float *c0 = cum.ptr<float>(y),     *c1 = cum.ptr<float>(y+1);
+        const float *c2 = cum.ptr<float>(y+ps),  *c3 = cum.ptr<float>(y+ps+1);
+        float v[ps+1], cs[ps];
+        for (int k=0; k<=ps; k++)
+            v[k] = (c2[x+k] - c0[x+k]) + (c3[x+k] - c1[x+k]);
+        for (int k=0; k<ps; k++)
+            cs[k] = 0.25f * (v[k] + v[k+1]);
+        for (int n=0; n<keep; n++)
         {
-            fast_had(in.total(), lev, h.ptr<float>(), wh.ptr<float>());
-            if (lev>4) cv::swap(h,wh);
+            int s = n >> 1, p = n & 1;
+            float sum = 0;
+            for (int m=0; m<ps/2; m++)
+            {
+                int b = m & s;
+                int neg = (b ^ (b>>1) ^ (b>>2)) & 1;
+                sum += neg ? -cs[2*m+p] : cs[2*m+p];
+            }
+            out[n] = sum;
         }
-        return wh(Rect(0,0,keep,1));
     }
+
     virtual int extract(const Mat &img, Mat &features) const
     {
-        Mat fI; 
-        img.convertTo(fI,CV_32F);
-        Mat dx,dy;
-        Sobel(fI,dx,CV_32F,1,0);
-        Sobel(fI,dy,CV_32F,0,1);
-        const int ps = 16;
-        const float step = 3;
-        for (float i=ps/4; i<img.rows-3*ps/4; i+=step)
+        Gradients grad(img);
+        Mat_<float> cx, cy;
+        colsums(grad->dx(), cx);
+        colsums(grad->dy(), cy);
+
+        int ny=0, nx=0;
+        for (int i=ps/4; i<img.rows-3*ps/4; i+=step) ny++;
+        for (int j=ps/4; j<img.cols-3*ps/4; j+=step) nx++;
+        features.create(1, ny*nx*2*keep, CV_32F);
+        float *out = features.ptr<float>(0);
+        for (int i=ps/4; i<img.rows-3*ps/4; i+=step)
         {
-            for (float j=ps/4; j<img.cols-3*ps/4; j+=step)
+            for (int j=ps/4; j<img.cols-3*ps/4; j+=step)
             {
-                Mat patch;
-                cv::getRectSubPix(dx,Size(ps,ps),Point2f(j,i),patch);
-                features.push_back(project(patch));
-                cv::getRectSubPix(dy,Size(ps,ps),Point2f(j,i),patch);
-                features.push_back(project(patch));
+                // a 16x16 patch centered at (j,i) spans [i-7.5,i+7.5]
+                project(cx, i, j, out); out += keep;
+                project(cy, i, j, out); out += keep;
             }
         }
-        features = features.reshape(1,1);
         return features.total() * features.elemSize();
     }
 };
 
+
+//
+// extract a range of images straight into their rows of a preallocated batch
+//
+struct BatchRows : public ParallelLoopBody
+{
+    const Extractor &ext;
+    const vector<Mat> &images;
+    Mat &features;
+
+    BatchRows(const Extractor &ext, const vector<Mat> &images, Mat &features)
+        : ext(ext), images(images), features(features)
+    {}
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i=range.start; i<range.end; i++)
+        {
+            Mat f;
+            ext.extract(images[i], f);
+            f = f.reshape(1,1);
+            CV_Assert(f.cols == features.cols && f.type() == features.type());
+            f.copyTo(features.row(i));
+        }
+    }
+};
+
+
+//
+// several extractors concatenated into one (float) row.
+// each image is run inside an ImageScope, so the intermediates the members
+// have in common (gradients, landmarks, lbp code images, hdlbp scales)
+// are computed only once per image.
+// the 1st image fixes each member's slice [off[k],off[k+1]) of the row,
+// the others are written straight into them.
+//
+struct ExtractorFusion : public TextureFeature::Extractor
+{
+    vector< Ptr<Extractor> > member;
+
+    ExtractorFusion(const vector< Ptr<Extractor> > &member) : member(member) {}
+
+    void fill(const Mat &img, Mat &row, const vector<int> &off) const
+    {
+        ImageScope scope(img);
+        for (size_t k=0; k<member.size(); k++)
+        {
+            Mat f;
+            member[k]->extract(img, f);
+            f = f.reshape(1,1);
+            CV_Assert(f.cols == off[k+1]-off[k]);
+            Mat slice = row.colRange(off[k], off[k+1]);
+            f.convertTo(slice, CV_32F);
+        }
+    }
+
+    int layout(const Mat &img, Mat &row, vector<int> &off) const
+    {
+        ImageScope scope(img);
+        vector<Mat> f(member.size());
+        off.assign(1, 0);
+        for (size_t k=0; k<member.size(); k++)
+        {
+            member[k]->extract(img, f[k]);
+            f[k] = f[k].reshape(1,1);
+            off.push_back(off.back() + f[k].cols);
+        }
+        row.create(1, off.back(), CV_32F);
+        for (size_t k=0; k<member.size(); k++)
+        {
+            Mat slice = row.colRange(off[k], off[k+1]);
+            f[k].convertTo(slice, CV_32F);
+        }
+        return off.back();
+    }
+
+    // TextureFeature::Extractor
+    virtual int extract(const Mat &img, Mat &features) const
+    {
+        vector<int> off;
+        layout(img, features, off);
+        return features.total() * features.elemSize();
+    }
+
+    virtual int extractBatch(const std::vector<Mat> &images, Mat &features) const;
+};
+
+struct FusionRows : public ParallelLoopBody
+{
+    const ExtractorFusion &fusion;
+    const vector<Mat> &images;
+    const vector<int> &off;
+    Mat &features;
+
+    FusionRows(const ExtractorFusion &fusion, const vector<Mat> &images, const vector<int> &off, Mat &features)
+        : fusion(fusion), images(images), off(off), features(features)
+    {}
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i=range.start; i<range.end; i++)
+        {
+            Mat row = features.row(i);
+            fusion.fill(images[i], row, off);
+        }
+    }
+};
+
+int ExtractorFusion::extractBatch(const std::vector<Mat> &images, Mat &features) const
+{
+    features.release();
+    if (images.empty())
+        return 0;
+
+    Mat f;
+    vector<int> off;
+    int cols = layout(images[0], f, off);
+    features.create(int(images.size()), cols, CV_32F);
+    f.copyTo(features.row(0));
+
+    parallel_for_(Range(1, int(images.size())), FusionRows(*this, images, off, features));
+    return features.cols * features.elemSize();
+}
+
 } // TextureFeatureImpl
 
 namespace TextureFeature
 {
 using namespace TextureFeatureImpl;
 
+//
+// the 1st image fixes size and type of the output rows, the rest is run in parallel.
+//
+int Extractor::extractBatch(const std::vector<Mat> &images, Mat &features) const
+{
+    features.release();
+    if (images.empty())
+        return 0;
+
+    Mat f;
+    extract(images[0], f);
+    f = f.reshape(1,1);
+    features.create(int(images.size()), f.cols, f.type());
+    f.copyTo(features.row(0));
+
+    parallel_for_(Range(1, int(images.size())), BatchRows(*this, images, features));
+    return features.cols * features.elemSize();
+}
+
 Ptr<Extractor> createExtractor(int extract)
 {
     switch(int(extract))
     {
         case EXT_Pixels:   return makePtr< ExtractorPixels >(); break;
-        case EXT_Lbp:      return makePtr< GenericExtractor<FeatureLbp,GriddedHist> >(FeatureLbp(), GriddedHist()); break;
-        case EXT_LBP_P:    return makePtr< GenericExtractor<FeatureLbp,PyramidGrid> >(FeatureLbp(), PyramidGrid()); break;
-        case EXT_LBPU_P:   return makePtr< GenericExtractor<FeatureLbp,PyramidGrid> >(FeatureLbp(), PyramidGrid(true)); break;
-        case EXT_TPLbp:    return makePtr< GenericExtractor<FeatureTPLbp,GriddedHist> >(FeatureTPLbp(), GriddedHist()); break;
-        case EXT_TPLBP_P:  return makePtr< GenericExtractor<FeatureTPLbp,PyramidGrid> >(FeatureTPLbp(), PyramidGrid()); break;
+        case EXT_Lbp:      return makePtr< FusedExtractor<FeatureLbp,GriddedHist> >(FeatureLbp(), GriddedHist()); break;
+        case EXT_LBP_P:    return makePtr< FusedExtractor<FeatureLbp,PyramidGrid> >(FeatureLbp(), PyramidGrid()); break;
+        case EXT_LBPU_P:   return makePtr< FusedExtractor<FeatureUniform<FeatureLbp>,PyramidGrid> >(FeatureUniform<FeatureLbp>(), PyramidGrid()); break;
+        case EXT_TPLbp:    return makePtr< FusedExtractor<FeatureTPLbp,GriddedHist> >(FeatureTPLbp(), GriddedHist()); break;
+        case EXT_TPLBP_P:  return makePtr< FusedExtractor<FeatureTPLbp,PyramidGrid> >(FeatureTPLbp(), PyramidGrid()); break;
         case EXT_TPLBP_G:  return makePtr< GenericExtractor<FeatureTPLbp,GfttGrid> >(FeatureTPLbp(), GfttGrid()); break;
-        case EXT_FPLbp:    return makePtr< GenericExtractor<FeatureFPLbp,GriddedHist> >(FeatureFPLbp(), GriddedHist()); break;
-        case EXT_FPLBP_P:  return makePtr< GenericExtractor<FeatureMTS,PyramidGrid> >(FeatureMTS(), PyramidGrid()); break;
-        case EXT_MTS:      return makePtr< GenericExtractor<FeatureMTS,GriddedHist> >(FeatureMTS(), GriddedHist()); break;
-        case EXT_MTS_P:    return makePtr< GenericExtractor<FeatureMTS,PyramidGrid> >(FeatureMTS(), PyramidGrid()); break;
-        case EXT_BGC1:     return makePtr< GenericExtractor<FeatureBGC1,GriddedHist> >(FeatureBGC1(), GriddedHist()); break;
-        case EXT_BGC1_P:   return makePtr< GenericExtractor<FeatureBGC1,PyramidGrid> >(FeatureBGC1(), PyramidGrid()); break;
+        case EXT_FPLbp:    return makePtr< FusedExtractor<FeatureFPLbp,GriddedHist> >(FeatureFPLbp(), GriddedHist()); break;
+        case EXT_FPLBP_P:  return makePtr< FusedExtractor<FeatureMTS,PyramidGrid> >(FeatureMTS(), PyramidGrid()); break;
+        case EXT_MTS:      return makePtr< FusedExtractor<FeatureMTS,GriddedHist> >(FeatureMTS(), GriddedHist()); break;
+        case EXT_MTS_P:    return makePtr< FusedExtractor<FeatureMTS,PyramidGrid> >(FeatureMTS(), PyramidGrid()); break;
+        case EXT_BGC1:     return makePtr< FusedExtractor<FeatureBGC1,GriddedHist> >(FeatureBGC1(), GriddedHist()); break;
+        case EXT_BGC1_P:   return makePtr< FusedExtractor<FeatureBGC1,PyramidGrid> >(FeatureBGC1(), PyramidGrid()); break;
         case EXT_COMB:     return makePtr< CombinedExtractor<GriddedHist> >(GriddedHist()); break;
         case EXT_COMB_P:   return makePtr< CombinedExtractor<PyramidGrid> >(PyramidGrid()); break;
         case EXT_COMB_G:   return makePtr< CombinedExtractor<GfttGrid> >(GfttGrid()); break;
         case EXT_Dct:      return makePtr< ExtractorDct >(); break;
         case EXT_Orb:      return makePtr< ExtractorORBGrid >();  break;
         case EXT_Sift:     return makePtr< ExtractorSIFTGrid >(20); break;
-        case EXT_Sift_G:   return makePtr< ExtractorGfttFeature2d >(xfeatures2d::SIFT::create()); break;
+        case EXT_Sift_G:   return makePtr< ExtractorSIFTGftt >(); break;
         case EXT_Grad:     return makePtr< GenericExtractor<FeatureGrad,GriddedHist> >(FeatureGrad(),GriddedHist());  break;
         case EXT_Grad_G:   return makePtr< GenericExtractor<FeatureGrad,GfttGrid> >(FeatureGrad(),GfttGrid()); break;
         case EXT_Grad_P:   return makePtr< GenericExtractor<FeatureGrad,PyramidGrid> >(FeatureGrad(),PyramidGrid()); break;
@@ -1314,9 +2891,44 @@ Ptr<Extractor> createExtractor(int extract)
         case EXT_HDLBP_PCA:  return makePtr< HighDimLbpPCA >();  break;
         case EXT_PCASIFT:  return makePtr< HighDimPCASift >();  break;
         case EXT_CDIKP:    return makePtr< ExtractorCDIKP >();  break;
+        case EXT_HDLBP_I:  return makePtr< HighDimLbp >(false);  break;
+        case EXT_DSift:    return makePtr< ExtractorDenseSift >(20); break;
         default: cerr << "extraction " << extract << " is not yet supported." << endl; exit(-1);
     }
     return Ptr<Extractor>();
 }
 
+Ptr<Extractor> createExtractor(int extract, int land)
+{
+    LandMarkChoiceScope scope(land);
+    return createExtractor(extract);
+}
+
+void setLandmarks(int land)
+{
+    landmark_default = land;
+}
+
+double landmarkLatency(int land, int *calls)
+{
+    Ptr<LandMarkBackend> b;
+    if (land >= 0 && land < LAND_MAX)
+    {
+        AutoLock lock(asset_mutex);
+        b = landmark_backends[land];
+    }
+    int n = 0;
+    double ms = b.empty() ? 0 : b->latency(n);
+    if (calls) *calls = n;
+    return ms;
+}
+
+Ptr<Extractor> createExtractor(const std::vector<int> &extract)
+{
+    vector< Ptr<Extractor> > member;
+    for (size_t k=0; k<extract.size(); k++)
+        member.push_back(createExtractor(extract[k]));
+    return makePtr< ExtractorFusion >(member);
+}
+
 } // namespace TextureFeatureImpl
@@ -165,6 +165,26 @@ namespace TextureFeature
 {
 using namespace TextureFeatureImpl;
 
+//
+// the 1st row fixes the size, the rest goes straight into place
+//   (no growing Mat next to the unfiltered batch)
+//
+int Filter::filterBatch(const Mat &src, Mat &dest) const
+{
+    Mat filtered;
+    for (int i=0; i<src.rows; i++)
+    {
+        Mat fr;
+        filter(src.row(i), fr);
+        if (i == 0)
+            filtered.create(src.rows, int(fr.total()), CV_32F);
+        Mat row = filtered.row(i);
+        fr.reshape(1,1).convertTo(row, CV_32F);
+    }
+    dest = filtered;
+    return dest.cols;
+}
+
 
 Ptr<Filter> createFilter(int filt)
 {
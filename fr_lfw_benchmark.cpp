@@ -102,8 +102,8 @@ class MyFace
     Ptr<TextureFeature::Verifier>  cls;
     Preprocessor pre;
 
+    vector<Mat> images; // collected in addTraining(), extracted as one batch in train()
     Mat labels;
-    Mat features;
     int nimg;
 
 public:
@@ -115,38 +115,38 @@ public:
         ext = TextureFeature::createExtractor(extract);
         fil = TextureFeature::createFilter(filt);
         cls = TextureFeature::createVerifier(clsfy);
+        images.reserve(nimg);
     }
 
     virtual int addTraining(const Mat & img, int label) 
     {
-        Mat feat1;
-        ext->extract(pre.process(img), feat1);
-
-        Mat fr = feat1.reshape(1,1);
-        if (fr.type() != CV_32F)
-            fr.convertTo(fr,CV_32F);
-
-        if (! fil.empty())
-            fil->filter(fr,fr);
-
-        //features.push_back(fr); // damn memory problems
-        if ( features.empty() )
-        {
-            features = Mat(nimg, feat1.total(), CV_32F); 
-        }
-        feat1.copyTo(features.row(labels.rows));
+        images.push_back(pre.process(img));
         labels.push_back(label);
-        cerr << fr.cols << " i_" << labels.rows << "\r";
+        cerr << " i_" << labels.rows << "\r";
         return labels.rows;
     }
     virtual bool train()
     {
+        Mat features;
+        {
+            PROFILEX("extract");
+            ext->extractBatch(images, features);
+        }
+        if (features.type() != CV_32F)
+            features.convertTo(features,CV_32F);
+
+        if (! fil.empty())
+        {
+            fil->filterBatch(features, features);
+        }
+        cerr << features.cols << " i_" << features.rows << "\r";
+
         //cerr << "\n." << features.cols << " ";
         //cerr << "start training." << " ";
         int ok = cls->train(features, labels.reshape(1,features.rows));
         //cerr << "done training." << endl;
         CV_Assert(ok);
-        features.release();
+        images.clear();
         labels.release();
         return ok!=0;
     }
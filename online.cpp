@@ -72,7 +72,7 @@ public:
         string last_n("");
         int label(-1);
 
-        Mat features;
+        vector<Mat> images;
         Mat labels;
 
         vector<String> vec;
@@ -97,14 +97,16 @@ public:
 
             // process img & add to trainset:
             Mat img=imread(vec[i],0);
-
-            Mat feature;
-            extractor->extract(pre.process(img), feature);
-            if (!filter.empty())
-                filter->filter(feature.reshape(1,1), feature);
-            features.push_back(feature);
+            images.push_back(pre.process(img));
             labels.push_back(label);
         }
+
+        Mat features;
+        extractor->extractBatch(images, features);
+        if (!filter.empty())
+        {
+            filter->filterBatch(features, features);
+        }
         return classifier->train(features, labels);
     }
 
@@ -0,0 +1,557 @@
+//
+// checks the fast paths in extractor.cpp against their plain references,
+//   on random images of odd sizes (so the vector loops get tails, too):
+//
+//   * vectorized code rows (sse2 / avx2) vs. the scalar code(), for every feature
+//   * fused grid / pyramid histograms vs. histograms of the code image,
+//     and both vs. a plain per-cell count
+//   * the single sweep COMB histograms vs. one pass per feature
+//   * GradBin, the dft gabor bank, the 4x4 dct, CDIKP and the generative
+//     part walk vs. the plain code they replaced
+//   * a fused multi-extractor vs. its members, one by one
+//   * the landmark cache vs. a plain lru list
+//
+// returns the number of failed checks.
+//
+
+#include "extractor.cpp"
+#include "elastic/elasticparts.cpp"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+using namespace TextureFeatureImpl;
+
+static int failed = 0;
+
+static void report(bool ok, const String &what)
+{
+    cout << (ok ? "ok      " : "FAILED  ") << what << endl;
+    if (!ok) failed ++;
+}
+
+static bool same(const Mat &a, const Mat &b)
+{
+    if (a.size() != b.size() || a.type() != b.type())
+        return false;
+    Mat ca = a.isContinuous() ? a : a.clone();
+    Mat cb = b.isContinuous() ? b : b.clone();
+    return memcmp(ca.data, cb.data, ca.total() * ca.elemSize()) == 0;
+}
+
+static Mat random_image(RNG &rng, int rows, int cols)
+{
+    Mat_<uchar> img(rows, cols);
+    for (int r=0; r<rows; r++)
+        for (int c=0; c<cols; c++)
+            img(r,c) = uchar(rng.uniform(0,256));
+    // some flat areas, so equal neighbours get compared as well
+    for (int r=0; r<rows/3; r++)
+        for (int c=0; c<cols/3; c++)
+            img(r,c) = 77;
+    return img;
+}
+
+static const int sizes[][2] = { {90,90}, {37,61}, {13,200}, {64,33}, {8,8} };
+static const int nsizes = 5;
+
+//
+// one code row vs. code() per pixel, border pixels must be 0.
+//
+template <class Feature>
+static bool check_row(const Feature &fea, const Mat_<uchar> &img, int r)
+{
+    const int R = fea.border();
+    vector<uchar> row(img.cols, 0xff);
+    code_row(fea, img, r, &row[0]);
+    for (int c=0; c<img.cols; c++)
+    {
+        bool inner = (r>=R && r<img.rows-R && c>=R && c<img.cols-R);
+        uchar ref = inner ? fea.code(img, r, c) : 0;
+        if (row[c] != ref)
+            return false;
+    }
+#ifdef HAVE_SSE
+    if (r<R || r>=img.rows-R)
+        return true;
+    // each vector width on its own, from the 1st inner pixel
+    vector<uchar> v(img.cols, 0);
+    int n = code_row_v<V128>(fea, img, r, &v[0], R);
+    for (int c=R; c<n; c++)
+        if (v[c] != fea.code(img, r, c))
+            return false;
+ #ifdef __AVX2__
+    n = code_row_v<V256>(fea, img, r, &v[0], R);
+    for (int c=R; c<n; c++)
+        if (v[c] != fea.code(img, r, c))
+            return false;
+ #endif
+#endif
+    return true;
+}
+
+template <class Feature>
+static void check_codes(const Feature &fea, const char *name, RNG &rng)
+{
+    bool ok = true;
+    for (int s=0; s<nsizes && ok; s++)
+    {
+        Mat_<uchar> img = random_image(rng, sizes[s][0], sizes[s][1]);
+        for (int r=0; r<img.rows && ok; r++)
+            ok = check_row(fea, img, r);
+        // the code image is made of the same rows
+        Mat fI;
+        fea(img, fI);
+        Mat_<uchar> ref(img.size(), uchar(0));
+        for (int r=fea.border(); r<img.rows-fea.border(); r++)
+            for (int c=fea.border(); c<img.cols-fea.border(); c++)
+                ref(r,c) = fea.code(img, r, c);
+        ok = ok && same(fI, ref);
+    }
+    report(ok, format("codes      %s", name));
+}
+
+//
+// plain per-cell count of a code image over the given grid levels,
+//   cells column-major per level, then normalized as a whole.
+//
+static Mat plain_hist(const Mat_<uchar> &fI, const int *gridx, const int *gridy, int nlevels, int histSize, const uchar *lut)
+{
+    vector<int> h;
+    for (int l=0; l<nlevels; l++)
+    {
+        int sw = fI.cols/gridx[l];
+        int sh = fI.rows/gridy[l];
+        for (int i=0; i<gridx[l]; i++)
+        {
+            for (int j=0; j<gridy[l]; j++)
+            {
+                vector<int> cell(histSize, 0);
+                for (int r=j*sh; r<(j+1)*sh; r++)
+                    for (int c=i*sw; c<(i+1)*sw; c++)
+                        cell[lut ? lut[fI(r,c)] : fI(r,c)] ++;
+                h.insert(h.end(), cell.begin(), cell.end());
+            }
+        }
+    }
+    Mat histo;
+    Mat(h).convertTo(histo, CV_32F);
+    normalize(histo.reshape(1,1), histo);
+    return histo;
+}
+
+template <class Feature>
+static void check_hist(const Feature &fea, const char *name, RNG &rng)
+{
+    bool ok = true;
+    int eight = 8, pyr[] = {5,6,7,8};
+    for (int s=0; s<nsizes && ok; s++)
+    {
+        Mat_<uchar> img = random_image(rng, sizes[s][0], sizes[s][1]);
+        Mat fI;
+        int bins = fea(img, fI);
+        Mat fused, coded;
+
+        GriddedHist grid;
+        grid.fused(fea, img, fused);
+        grid.hist(fI, coded, bins);
+        ok = ok && same(fused, coded) && same(coded, plain_hist(fI, &eight, &eight, 1, bins, 0));
+
+        PyramidGrid pyramid;
+        pyramid.fused(fea, img, fused);
+        pyramid.hist(fI, coded, bins);
+        ok = ok && same(fused, coded) && same(coded, plain_hist(fI, pyr, pyr, 4, bins, 0));
+
+        if (bins == 256)
+        {
+            PyramidGrid uniform(true);
+            uniform.fused(fea, img, fused);
+            uniform.hist(fI, coded, bins);
+            ok = ok && same(fused, coded) && same(coded, plain_hist(fI, pyr, pyr, 4, 60, uniform_lut));
+        }
+    }
+    report(ok, format("histograms %s", name));
+}
+
+template <class Grid>
+static void check_comb(const Grid &grid, const char *name, RNG &rng)
+{
+    CombinedFeatures comb;
+    bool ok = true;
+    for (int s=0; s<nsizes && ok; s++)
+    {
+        Mat_<uchar> img = random_image(rng, sizes[s][0], sizes[s][1]);
+        Mat sweep, passes;
+        comb.hist(grid, img, sweep);
+        comb.hist(grid, img, passes, comb.cs2);
+        comb.hist(grid, img, passes, comb.cs4);
+        comb.hist(grid, img, passes, comb.fp2);
+        comb.hist(grid, img, passes, comb.fp4);
+        comb.hist(grid, img, passes, comb.dia);
+        comb.hist(grid, img, passes, comb.sq);
+        ok = same(sweep.reshape(1,1), passes.reshape(1,1));
+    }
+    report(ok, format("comb       %s", name));
+}
+
+
+//
+// the old GradBin: fastAtan2 sectors, rings from the normalized magnitude
+//   (cells and rings clamped, as the old loop should have done).
+//
+static Mat ref_gradbin(const Mat &I, int nsec, int nrad, int grid)
+{
+    Mat s1, s2, s3(I.size(), CV_32F), s4(I.size(), CV_32F);
+    Sobel(I, s1, CV_32F, 1, 0);
+    Sobel(I, s2, CV_32F, 0, 1);
+    fastAtan2(s1.ptr<float>(0), s2.ptr<float>(0), s3.ptr<float>(0), int(I.total()), true);
+    s3 /= (360/nsec);
+    magnitude(s1.ptr<float>(0), s2.ptr<float>(0), s4.ptr<float>(0), int(I.total()));
+    normalize(s4,s4,nrad);
+
+    int sx = I.cols/(grid-1);
+    int sy = I.rows/(grid-1);
+    int nbins = nsec*nrad;
+    Mat features(1, nbins*grid*grid, CV_32F, Scalar(0));
+    for (int i=0; i<I.rows; i++)
+    {
+        int oy = std::min(i/sy, grid-1);
+        for (int j=0; j<I.cols; j++)
+        {
+            int ox = std::min(j/sx, grid-1);
+            int off = nbins*(oy*grid + ox);
+            int g = (int)s3.at<float>(i,j);
+            int m = std::min((int)s4.at<float>(i,j), nrad-1);
+            features.at<float>(off + g + m*nsec) ++;
+        }
+    }
+    return features;
+}
+
+static void check_gradbin(int nsec, int nrad, int grid, RNG &rng)
+{
+    static const int gsizes[][2] = { {90,90}, {37,61}, {64,33}, {48,40} };
+    bool ok = true;
+    for (int s=0; s<8 && ok; s++)
+    {
+        Mat img = random_image(rng, gsizes[s/2][0], gsizes[s/2][1]);
+        if (s & 1)
+        {
+            // a single dominant gradient, the only way to reach the outer rings
+            img.setTo(Scalar(50));
+            img.at<uchar>(img.rows/2, img.cols/3) = 250;
+        }
+        Mat f;
+        ExtractorGradBin(nsec, nrad, grid).extract(img, f);
+        Mat fr;
+        f.reshape(1,1).convertTo(fr, CV_32F);
+        ok = same(fr, ref_gradbin(img, nsec, nrad, grid));
+    }
+    report(ok, format("gradbin    %d sectors, %d rings, grid %d", nsec, nrad, grid));
+}
+
+//
+// the dft path of the gabor bank vs. filter2D with the same kernels,
+//   within float rounding of the transforms.
+//
+static void check_gabor(RNG &rng)
+{
+    GaborBank bank(Size(9,9));
+    bool ok = true;
+    for (int n=0; n<3 && ok; n++)
+    {
+        Mat src_f, dest[GaborBank::N];
+        random_image(rng, 90, 90).convertTo(src_f, CV_32F, 1.0/255.0);
+        bank.filter(src_f, dest);
+        for (int i=0; i<GaborBank::N && ok; i++)
+        {
+            Mat ref;
+            filter2D(src_f, ref, CV_32F, bank.kernel[i]);
+            double m = norm(ref, NORM_INF);
+            ok = dest[i].size() == ref.size() && norm(dest[i], ref, NORM_INF) <= 1e-5 * std::max(m, 1.0);
+        }
+    }
+    report(ok, "gabor      dft bank vs. filter2D");
+}
+
+//
+// cv::dct on each 8x8 block, the 4x4 top-left kept, blocks column by column.
+//
+static void check_dct(RNG &rng)
+{
+    static const int dsizes[][2] = { {90,90}, {64,64}, {40,72}, {61,37} };
+    const int grid = 8;
+    bool ok = true;
+    for (int s=0; s<4 && ok; s++)
+    {
+        Mat img = random_image(rng, dsizes[s][0], dsizes[s][1]);
+        Mat src, ref, f;
+        img.convertTo(src, CV_32F, 1.0/255.0);
+        for (int x=0; x<src.cols-grid; x+=grid)
+        {
+            for (int y=0; y<src.rows-grid; y+=grid)
+            {
+                Mat d;
+                dct(src(Rect(x,y,grid,grid)), d);
+                Mat e = d(Rect(0,0,grid/2,grid/2)).clone();
+                ref.push_back(e.reshape(1,1));
+            }
+        }
+        ref = ref.reshape(1,1);
+        ExtractorDct().extract(img, f);
+        ok = f.size() == ref.size() && norm(f, ref, NORM_INF) <= 2e-6;
+    }
+    report(ok, "dct        4x4 kernel vs. cv::dct");
+}
+
+//
+// the old CDIKP: a walsh-hadamard transform of each 16x16 gradient patch.
+//
+static void fast_had(int ndim, int lev, float *in, float *out)
+{
+    int h = lev/2;
+    for (int j=0; j<ndim/lev; j++)
+    {
+        for (int i=0; i<h; i++)
+        {
+            out[i]   = in[i] + in[i+h];
+            out[i+h] = in[i] - in[i+h];
+        }
+        out += lev;
+        in  += lev;
+    }
+}
+static Mat had_project(const Mat &in)
+{
+    const int keep = 10;
+    Mat h = in.clone().reshape(1,1);
+    Mat wh(1, int(h.total()), h.type());
+    for (int lev=int(in.total()); lev>2; lev/=2)
+    {
+        fast_had(int(in.total()), lev, h.ptr<float>(), wh.ptr<float>());
+        if (lev>4) cv::swap(h,wh);
+    }
+    return wh(Rect(0,0,keep,1));
+}
+static Mat ref_cdikp(const Mat &img)
+{
+    Mat fI, dx, dy, features;
+    img.convertTo(fI,CV_32F);
+    Sobel(fI,dx,CV_32F,1,0);
+    Sobel(fI,dy,CV_32F,0,1);
+    const int ps = 16;
+    const float step = 3;
+    for (float i=ps/4; i<img.rows-3*ps/4; i+=step)
+    {
+        for (float j=ps/4; j<img.cols-3*ps/4; j+=step)
+        {
+            Mat patch;
+            getRectSubPix(dx,Size(ps,ps),Point2f(j,i),patch);
+            features.push_back(had_project(patch));
+            getRectSubPix(dy,Size(ps,ps),Point2f(j,i),patch);
+            features.push_back(had_project(patch));
+        }
+    }
+    return features.reshape(1,1);
+}
+
+static void check_cdikp(RNG &rng)
+{
+    static const int csizes[][2] = { {90,90}, {64,48}, {30,41} };
+    bool ok = true;
+    for (int s=0; s<3 && ok; s++)
+    {
+        Mat img = random_image(rng, csizes[s][0], csizes[s][1]);
+        Mat f;
+        ExtractorCDIKP().extract(img, f);
+        ok = same(f, ref_cdikp(img));
+    }
+    report(ok, "cdikp      running sums vs. hadamard patches");
+}
+
+//
+// the old walk: one getRectSubPix per candidate, strict < in row major order.
+//
+static double ref_walk(const Generative::Part &P, const Mat &img, Point2f &np)
+{
+    const int step = Generative::Part::step;
+    double mDist = DBL_MAX;
+    Point2f best(np);
+    for (int r=-step; r<step; r++)
+    {
+        for (int c=-step; c<step; c++)
+        {
+            Point2f rs(np.x+c, np.y+r);
+            Mat_<float> patch, F(P.f);
+            getRectSubPix(img, F.size(), rs, patch);
+            double d = 0;
+            for (int y=0; y<F.rows; y++)
+                for (int x=0; x<F.cols; x++)
+                {
+                    double v = patch(y,x) - F(y,x);
+                    d += v*v;
+                }
+            if (d < mDist)
+            {
+                mDist = d;
+                best = rs;
+            }
+        }
+    }
+    np = best;
+    return sqrt(mDist);
+}
+
+static void check_walk(RNG &rng)
+{
+    bool ok = true;
+    for (int t=0; t<60 && ok; t++)
+    {
+        // random angles, or a checker board (lots of equal windows)
+        Mat_<float> img(180, 180);
+        for (int r=0; r<img.rows; r++)
+            for (int c=0; c<img.cols; c++)
+                img(r,c) = (t%3==0) ? float((r/20 + c/20)%2 * 100) : float(rng.uniform(0,360));
+        Point2f p(rng.uniform(0,1800)/10.f, rng.uniform(0,1800)/10.f);
+        Generative::Part P(Point2f(rng.uniform(0,1800)/10.f, rng.uniform(0,1800)/10.f), img);
+        if (t%5 == 0)
+            P.f = img(Rect(30,30,P.f.cols,P.f.rows)).clone();
+        Point2f a(p), b(p);
+        double da = P.walk(img, a);
+        double db = ref_walk(P, img, b);
+        // same argmin; the distance only within rounding of the bilinear weights
+        ok = (a == b) && fabs(da - db) <= 1e-5 * std::max(db, 1.0);
+    }
+    report(ok, "walk       one search area vs. a patch per candidate");
+}
+
+//
+// a fused multi-extractor vs. its members run one by one (fixed landmarks,
+//   so no model files are needed), for single images and for a batch.
+//
+static void check_fusion(RNG &rng)
+{
+    int e[] = { EXT_Lbp, EXT_LBP_P, EXT_MTS_P, EXT_COMB_P, EXT_GradBin, EXT_CDIKP, EXT_HDLBP, EXT_HDLBP_I };
+    vector<int> ext(e, e + sizeof(e)/sizeof(int));
+    setLandmarks(LAND_FIXED);
+    Ptr<Extractor> fusion = createExtractor(ext);
+
+    vector<Mat> images;
+    for (int n=0; n<3; n++)
+        images.push_back(random_image(rng, 90, 90));
+    Mat batch;
+    fusion->extractBatch(images, batch);
+
+    bool ok = (batch.rows == int(images.size()));
+    for (size_t n=0; n<images.size() && ok; n++)
+    {
+        Mat ref;
+        for (size_t k=0; k<ext.size(); k++)
+        {
+            Mat f, g;
+            createExtractor(ext[k])->extract(images[n], f);
+            f.reshape(1,1).convertTo(g, CV_32F);
+            if (ref.empty()) ref = g; else hconcat(ref, g, ref);
+        }
+        Mat one;
+        fusion->extract(images[n], one);
+        ok = same(one.reshape(1,1), ref) && same(batch.row(int(n)), ref);
+    }
+    report(ok, "fusion     members in one scope vs. one by one");
+}
+
+//
+// the landmark cache vs. a plain list of keys (most recent first),
+//   on random gets and puts of a few images, for 2 backend kinds.
+//
+static void check_lmcache(RNG &rng)
+{
+    const size_t capacity = 6;
+    LandMarkCache cache(capacity);
+    vector<Mat> images;
+    for (int n=0; n<10; n++)
+        images.push_back(random_image(rng, 16, 16));
+    images.push_back(images[3].clone()); // same content, other buffer
+
+    vector< std::pair<int,int> > lru; // (image, land), most recent first
+    bool ok = true;
+    for (int t=0; t<2000 && ok; t++)
+    {
+        int n = rng.uniform(0, int(images.size()));
+        int land = rng.uniform(0, 2);
+        int id = (n == 10) ? 3 : n; // the clone hits the original
+        LandMarkCache::Key k = LandMarkCache::key(images[n], land);
+        vector<Point> kp;
+        bool hit = cache.get(k, kp);
+
+        size_t i=0;
+        while (i<lru.size() && lru[i] != std::make_pair(id, land)) i++;
+        bool ref_hit = (i < lru.size());
+        ok = (hit == ref_hit) && (!hit || (kp.size() == 1 && kp[0] == Point(id, land)));
+        if (ref_hit)
+        {
+            lru.erase(lru.begin() + i);
+            lru.insert(lru.begin(), std::make_pair(id, land));
+            continue;
+        }
+        cache.put(k, vector<Point>(1, Point(id, land)));
+        lru.insert(lru.begin(), std::make_pair(id, land));
+        if (lru.size() > capacity)
+            lru.pop_back();
+    }
+    report(ok, "lmcache    lru vs. a plain list");
+}
+
+
+int main(int argc, const char *argv[])
+{
+#ifdef HAVE_SSE
+ #ifdef __AVX2__
+    cout << "(sse2 + avx2)" << endl;
+ #else
+    cout << "(sse2)" << endl;
+ #endif
+#else
+    cout << "(scalar only)" << endl;
+#endif
+    RNG rng(0x5eed);
+
+    check_codes(FeatureLbp(), "Lbp", rng);
+    check_codes(FeatureUniform<FeatureLbp>(), "Uniform<Lbp>", rng);
+    check_codes(FeatureCsLbp<2>(), "CsLbp<2>", rng);
+    check_codes(FeatureCsLbp<4>(), "CsLbp<4>", rng);
+    check_codes(FeatureDiamondLbp<3>(), "DiamondLbp<3>", rng);
+    check_codes(FeatureSquareLbp<4>(), "SquareLbp<4>", rng);
+    check_codes(FeatureMTS(), "MTS", rng);
+    check_codes(FeatureBGC1(), "BGC1", rng);
+    check_codes(FeatureTPLbp(), "TPLbp", rng);
+    check_codes(FeatureFPLbp(2), "FPLbp(2)", rng);
+    check_codes(FeatureFPLbp(4), "FPLbp(4)", rng);
+    check_codes(FeatureLbpT<8,2,true>(), "LbpT<8,2,interp>", rng);
+    check_codes(FeatureLbpT<16,2,true,LBP_SYM>(), "LbpT<16,2,interp,sym>", rng);
+    check_codes(FeatureLbpT<8,2,false,LBP_RING>(), "LbpT<8,2,ring>", rng);
+
+    check_hist(FeatureLbp(), "Lbp", rng);
+    check_hist(FeatureUniform<FeatureLbp>(), "Uniform<Lbp>", rng);
+    check_hist(FeatureMTS(), "MTS", rng);
+    check_hist(FeatureTPLbp(), "TPLbp", rng);
+    check_hist(FeatureFPLbp(2), "FPLbp(2)", rng);
+    check_hist(FeatureBGC1(), "BGC1", rng);
+
+    check_comb(GriddedHist(), "grid", rng);
+    check_comb(PyramidGrid(), "pyramid", rng);
+
+    check_gradbin(8, 2, 18, rng);
+    check_gradbin(8, 2, 12, rng);
+    check_gradbin(8, 3, 18, rng);
+    check_gabor(rng);
+    check_dct(rng);
+    check_cdikp(rng);
+    check_walk(rng);
+    check_fusion(rng);
+    check_lmcache(rng);
+
+    cout << (failed ? format("%d check(s) failed.", failed) : String("all checks passed.")) << endl;
+    return failed;
+}
@@ -15,11 +15,17 @@ namespace TextureFeature
     struct Extractor
     {
         virtual int extract(const Mat &img, Mat &features) const = 0;
+
+        // one feature row per image, the default runs extract() in parallel
+        virtual int extractBatch(const std::vector<Mat> &images, Mat &features) const;
     };
 
     struct Filter
     {
         virtual int filter(const Mat &src, Mat &dest) const = 0;
+
+        // filter each row of a batch into one (float) row of dest
+        virtual int filterBatch(const Mat &src, Mat &dest) const;
     };
 
     struct Serialize // io
@@ -91,6 +97,8 @@ namespace TextureFeature
         EXT_HDLBP_PCA,
         EXT_PCASIFT,
         EXT_CDIKP,
+        EXT_HDLBP_I,
+        EXT_DSift,
         EXT_MAX
     };
     static const char *EXS[] = {
@@ -127,6 +135,8 @@ namespace TextureFeature
         "HDLBP_PCA",
         "PCASIFT",
         "CDIKP",
+        "HDLBP_I",
+        "DSift",
         0
     };
     enum FIL {
@@ -163,6 +173,20 @@ namespace TextureFeature
         "DCT24",
         0
     };
+    enum LAND {
+        LAND_FIXED,
+        LAND_DLIB,
+        LAND_ELASTIC,
+        LAND_ELASTIC_GEN,
+        LAND_MAX
+    };
+    static const char *LANDS[] = {
+        "fixed",
+        "dlib",
+        "elastic",
+        "elastic_gen",
+        0
+    };
     enum CLA {
         CL_NORM_L2,
         CL_NORM_L2SQR,
@@ -217,9 +241,18 @@ namespace TextureFeature
     };
 
     cv::Ptr<Extractor>  createExtractor(int ext);
+    // with its own landmark backend
+    cv::Ptr<Extractor>  createExtractor(int ext, int land);
+    // one row of all, sharing their per-image intermediates
+    cv::Ptr<Extractor>  createExtractor(const std::vector<int> &ext);
     cv::Ptr<Filter>     createFilter(int fil);
     cv::Ptr<Classifier> createClassifier(int cla);
     cv::Ptr<Verifier>   createVerifier(int ver);
+
+    // landmark backend for the extractors created from now on
+    void   setLandmarks(int land);
+    // mean milliseconds per detector call so far (and the count)
+    double landmarkLatency(int land, int *calls=0);
 }
 
 